@@ -0,0 +1,33 @@
+#pragma once
+#include "cancellation.h"
+#include <functional>
+#include <string>
+
+// Outcome of one backend job
+struct BackendResult {
+  bool ok = false;
+  // Cancelled after some output was produced; output holds what there is
+  bool partial = false;
+  std::string output;
+  std::string error;
+};
+
+// Receives output incrementally, in order, as the backend produces it
+using ChunkCallback = std::function<void(const std::string &chunk)>;
+
+// Something that turns input text into output text: a translation route, an
+// LLM, ... Jobs are run by the BackendScheduler, which limits how many run
+// at once per Kind(), so a new backend only has to implement Run.
+class Backend {
+public:
+  virtual ~Backend() = default;
+
+  // Backends of the same kind share one concurrency limit ("ct2", "ollama")
+  virtual std::string Kind() const = 0;
+
+  // Blocking. Must poll cancel (which may be null) and return promptly once
+  // it fires, with partial output if any.
+  virtual BackendResult Run(const std::string &input,
+                            const CancellationTokenPtr &cancel,
+                            const ChunkCallback &on_chunk) = 0;
+};
@@ -0,0 +1,229 @@
+#include "backend_scheduler.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+const size_t kDefaultTranslationLimit = 2;
+const size_t kDefaultLimit = 4;
+
+double elapsed_ms(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - since)
+      .count();
+}
+
+BackendResult cancelled_result(const CancellationToken &cancel) {
+  BackendResult result;
+  result.error = cancel.DeadlinePassed() ? "Deadline exceeded before start"
+                                         : "Cancelled before start";
+  return result;
+}
+
+} // namespace
+
+BackendScheduler &BackendScheduler::GetInstance() {
+  static BackendScheduler instance;
+  return instance;
+}
+
+BackendScheduler::~BackendScheduler() {
+  std::vector<std::thread> workers;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    for (auto &entry : lanes) {
+      for (auto &job : entry.second.queue) {
+        BackendResult result;
+        result.error = "Scheduler stopped";
+        job->promise.set_value(result);
+      }
+      entry.second.queue.clear();
+      for (auto &worker : entry.second.workers) {
+        workers.push_back(std::move(worker));
+      }
+    }
+  }
+  cv.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+BackendScheduler::Lane &BackendScheduler::GetLane(const std::string &kind) {
+  Lane &lane = lanes[kind];
+  if (lane.limit == 0) {
+    lane.limit = kind == "ct2" ? kDefaultTranslationLimit : kDefaultLimit;
+  }
+  return lane;
+}
+
+void BackendScheduler::StartWorkers(const std::string &kind, Lane &lane) {
+  while (lane.workers.size() < lane.limit) {
+    lane.workers.emplace_back(&BackendScheduler::Work, this, kind);
+  }
+}
+
+void BackendScheduler::SetConcurrencyLimit(const std::string &kind,
+                                           size_t limit) {
+  std::lock_guard<std::mutex> lock(mutex);
+  Lane &lane = GetLane(kind);
+  lane.limit = std::max<size_t>(1, limit);
+  // Extra workers of a lowered limit stay parked until it is raised again
+  if (!lane.workers.empty()) {
+    StartWorkers(kind, lane);
+  }
+  cv.notify_all();
+}
+
+std::future<BackendResult>
+BackendScheduler::Enqueue(std::shared_ptr<Backend> backend, std::string input,
+                          BackendJobOptions options, uint64_t &id) {
+  const std::string kind = backend->Kind();
+  auto job = std::make_unique<Job>();
+  job->backend = std::move(backend);
+  job->input = std::move(input);
+  job->options = std::move(options);
+  job->enqueued = std::chrono::steady_clock::now();
+  std::future<BackendResult> future = job->promise.get_future();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping) {
+      BackendResult result;
+      result.error = "Scheduler stopped";
+      job->promise.set_value(result);
+      return future;
+    }
+    id = job->id = ++nextId;
+    Lane &lane = GetLane(kind);
+    lane.queue.push_back(std::move(job));
+    lane.stats.submitted++;
+    lane.stats.queued++;
+    StartWorkers(kind, lane);
+  }
+  cv.notify_all();
+  return future;
+}
+
+std::future<BackendResult>
+BackendScheduler::Submit(std::shared_ptr<Backend> backend, std::string input,
+                         BackendJobOptions options) {
+  uint64_t id = 0;
+  return Enqueue(std::move(backend), std::move(input), std::move(options), id);
+}
+
+BackendResult BackendScheduler::Run(std::shared_ptr<Backend> backend,
+                                    std::string input,
+                                    BackendJobOptions options) {
+  const std::string kind = backend->Kind();
+  const CancellationTokenPtr cancel = options.cancel;
+  uint64_t id = 0;
+  std::future<BackendResult> future =
+      Enqueue(std::move(backend), std::move(input), std::move(options), id);
+  if (!cancel) {
+    return future.get();
+  }
+
+  // Once a job runs, the backend itself honors the token
+  while (future.wait_for(std::chrono::milliseconds(10)) !=
+         std::future_status::ready) {
+    if (cancel->IsCancelled() && Withdraw(kind, id)) {
+      return cancelled_result(*cancel);
+    }
+  }
+  return future.get();
+}
+
+bool BackendScheduler::Withdraw(const std::string &kind, uint64_t id) {
+  std::unique_ptr<Job> job;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Lane &lane = GetLane(kind);
+    auto it = std::find_if(
+        lane.queue.begin(), lane.queue.end(),
+        [id](const auto &queued) { return queued->id == id; });
+    if (it == lane.queue.end()) {
+      return false;
+    }
+    job = std::move(*it);
+    lane.queue.erase(it);
+    lane.stats.queued--;
+    lane.stats.cancelled++;
+  }
+  job->promise.set_value(cancelled_result(*job->options.cancel));
+  return true;
+}
+
+void BackendScheduler::Work(const std::string &kind) {
+  std::unique_lock<std::mutex> lock(mutex);
+  Lane &lane = lanes[kind];
+
+  while (true) {
+    cv.wait(lock, [&] {
+      return stopping ||
+             (!lane.queue.empty() && lane.stats.running < lane.limit);
+    });
+    if (stopping) {
+      return;
+    }
+
+    // Highest priority first, then submission order
+    auto it = std::max_element(
+        lane.queue.begin(), lane.queue.end(), [](const auto &a, const auto &b) {
+          if (a->options.priority != b->options.priority) {
+            return a->options.priority < b->options.priority;
+          }
+          return a->id > b->id;
+        });
+    std::unique_ptr<Job> job = std::move(*it);
+    lane.queue.erase(it);
+    lane.stats.queued--;
+    lane.stats.queue_ms += elapsed_ms(job->enqueued);
+
+    const CancellationTokenPtr &cancel = job->options.cancel;
+    if (cancel && cancel->IsCancelled()) {
+      lane.stats.cancelled++;
+      lock.unlock();
+      job->promise.set_value(cancelled_result(*cancel));
+      lock.lock();
+      continue;
+    }
+
+    lane.stats.running++;
+    lock.unlock();
+
+    const auto started = std::chrono::steady_clock::now();
+    BackendResult result;
+    try {
+      result = job->backend->Run(job->input, cancel, job->options.on_chunk);
+    } catch (const std::exception &e) {
+      result = BackendResult();
+      result.error = e.what();
+    }
+    const double run_ms = elapsed_ms(started);
+
+    lock.lock();
+    lane.stats.running--;
+    lane.stats.run_ms += run_ms;
+    if (cancel && cancel->IsCancelled()) {
+      lane.stats.cancelled++;
+    } else if (result.ok) {
+      lane.stats.completed++;
+    } else {
+      lane.stats.failed++;
+      std::cerr << "[WARN] " << kind << " job failed: " << result.error
+                << std::endl;
+    }
+    lock.unlock();
+    job->promise.set_value(std::move(result));
+    lock.lock();
+    // A slot is free again for a job waiting on the limit
+    cv.notify_all();
+  }
+}
+
+BackendStats BackendScheduler::GetStats(const std::string &kind) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return GetLane(kind).stats;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "backend.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Higher priorities are started first when jobs of one kind are waiting
+enum class BackendPriority { Background = 0, Normal = 1, Interactive = 2 };
+
+struct BackendJobOptions {
+  BackendPriority priority = BackendPriority::Normal;
+  CancellationTokenPtr cancel;
+  ChunkCallback on_chunk;
+};
+
+struct BackendStats {
+  uint64_t submitted = 0;
+  uint64_t completed = 0;
+  uint64_t failed = 0;
+  uint64_t cancelled = 0; // Includes jobs withdrawn before they started
+  size_t queued = 0;
+  size_t running = 0;
+  double queue_ms = 0.0; // Total time jobs waited to start
+  double run_ms = 0.0;   // Total time spent in Backend::Run
+};
+
+// Runs jobs for every backend with one admission policy. Each backend kind
+// has its own worker lane and concurrency limit, so CPU-bound translation
+// and IO-bound LLM requests overlap instead of queueing behind each other,
+// while neither can oversubscribe what it runs on.
+class BackendScheduler {
+public:
+  static BackendScheduler &GetInstance();
+
+  // Maximum jobs of this kind running at once. Defaults: "ct2" 2 (each job
+  // already uses several threads), anything else 4.
+  void SetConcurrencyLimit(const std::string &kind, size_t limit);
+
+  // Queue a job. The future resolves when it finishes; a job cancelled while
+  // queued resolves without running once a worker reaches it.
+  std::future<BackendResult> Submit(std::shared_ptr<Backend> backend,
+                                    std::string input,
+                                    BackendJobOptions options = {});
+
+  // Submit and wait. If the cancel token fires while the job is still
+  // queued, it is withdrawn and this returns immediately.
+  BackendResult Run(std::shared_ptr<Backend> backend, std::string input,
+                    BackendJobOptions options = {});
+
+  BackendStats GetStats(const std::string &kind);
+
+private:
+  BackendScheduler() = default;
+  ~BackendScheduler();
+  BackendScheduler(const BackendScheduler &) = delete;
+  BackendScheduler &operator=(const BackendScheduler &) = delete;
+
+  struct Job {
+    uint64_t id = 0;
+    std::shared_ptr<Backend> backend;
+    std::string input;
+    BackendJobOptions options;
+    std::chrono::steady_clock::time_point enqueued;
+    std::promise<BackendResult> promise;
+  };
+
+  struct Lane {
+    size_t limit = 0;
+    std::vector<std::unique_ptr<Job>> queue;
+    std::vector<std::thread> workers;
+    BackendStats stats;
+  };
+
+  std::future<BackendResult> Enqueue(std::shared_ptr<Backend> backend,
+                                     std::string input,
+                                     BackendJobOptions options, uint64_t &id);
+  Lane &GetLane(const std::string &kind);
+  void StartWorkers(const std::string &kind, Lane &lane);
+  void Work(const std::string &kind);
+  bool Withdraw(const std::string &kind, uint64_t id);
+
+  std::map<std::string, Lane> lanes;
+  uint64_t nextId = 0;
+  bool stopping = false;
+  std::mutex mutex;
+  std::condition_variable cv;
+};
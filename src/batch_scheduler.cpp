@@ -0,0 +1,199 @@
+#include "batch_scheduler.h"
+#include "package_stats.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+BatchScheduler::BatchScheduler(std::shared_ptr<TranslationModel> translator,
+                               std::string package_name,
+                               const BatchSchedulerOptions &options)
+    : translator(std::move(translator)), packageName(std::move(package_name)),
+      options(options) {
+  worker = std::thread(&BatchScheduler::Run, this);
+}
+
+BatchScheduler::~BatchScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    stopping = true;
+  }
+  queueCv.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+std::future<BatchScheduler::TokenBatch>
+BatchScheduler::Submit(TokenBatch batch, CancellationTokenPtr cancel) {
+  auto request = std::make_unique<Request>();
+  request->tokens = std::move(batch);
+  request->cancel = std::move(cancel);
+  for (const auto &tokens : request->tokens) {
+    request->token_count += tokens.size();
+  }
+  auto future = request->promise.get_future();
+
+  if (request->tokens.empty()) {
+    request->promise.set_value({});
+    return future;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    request->enqueued = std::chrono::steady_clock::now();
+    queuedTokens += request->token_count;
+    queuedSegments += request->tokens.size();
+    queue.push_back(std::move(request));
+  }
+  queueCv.notify_all();
+  return future;
+}
+
+BatchScheduler::TokenBatch
+BatchScheduler::TranslateTokens(TokenBatch batch, CancellationTokenPtr cancel) {
+  const size_t count = batch.size();
+  auto future = Submit(std::move(batch), cancel);
+  if (cancel) {
+    // Poll so a caller queued behind a long batch can still give up on time;
+    // the abandoned request is skipped when the worker reaches it
+    while (future.wait_for(std::chrono::milliseconds(10)) !=
+           std::future_status::ready) {
+      if (cancel->IsCancelled()) {
+        // A request already decoding stops at its next step; wait that long
+        // to keep the partial output
+        if (future.wait_for(std::chrono::milliseconds(100)) !=
+            std::future_status::ready) {
+          return TokenBatch(count);
+        }
+        break;
+      }
+    }
+  }
+  return future.get();
+}
+
+std::vector<std::string>
+BatchScheduler::TranslateBatch(const std::vector<std::string> &texts,
+                               CancellationTokenPtr cancel) {
+  TokenBatch batch;
+  batch.reserve(texts.size());
+  for (const auto &text : texts) {
+    batch.push_back(translator->encode(text));
+  }
+
+  TokenBatch results = TranslateTokens(std::move(batch), std::move(cancel));
+  std::vector<std::string> outputs;
+  outputs.reserve(results.size());
+  for (const auto &tokens : results) {
+    outputs.push_back(translator->decode(tokens));
+  }
+  return outputs;
+}
+
+void BatchScheduler::Run() {
+  std::unique_lock<std::mutex> lock(queueMutex);
+  std::vector<std::unique_ptr<Request>> taken;
+
+  while (true) {
+    queueCv.wait(lock, [this] { return stopping || !queue.empty(); });
+    if (queue.empty()) {
+      return; // Stopping with nothing left to do
+    }
+
+    // Give other callers until the window closes to join this batch
+    const auto deadline = queue.front()->enqueued + options.window;
+    queueCv.wait_until(lock, deadline, [this] {
+      return stopping || queuedTokens >= options.max_batch_tokens ||
+             queuedSegments >= options.max_batch_segments;
+    });
+
+    // Take whole requests while they fit; the first one always goes
+    size_t tokens = 0;
+    size_t segments = 0;
+    while (!queue.empty()) {
+      const auto &next = queue.front();
+      if (!taken.empty() &&
+          (tokens + next->token_count > options.max_batch_tokens ||
+           segments + next->tokens.size() > options.max_batch_segments)) {
+        break;
+      }
+      tokens += next->token_count;
+      segments += next->tokens.size();
+      taken.push_back(std::move(queue.front()));
+      queue.pop_front();
+    }
+    queuedTokens -= tokens;
+    queuedSegments -= segments;
+
+    lock.unlock();
+    Execute(taken);
+    taken.clear();
+    lock.lock();
+  }
+}
+
+void BatchScheduler::Execute(std::vector<std::unique_ptr<Request>> &requests) {
+  // Requests cancelled while queued finish now, without taking batch slots
+  auto cancelled = std::stable_partition(
+      requests.begin(), requests.end(), [](const auto &request) {
+        return !request->cancel || !request->cancel->IsCancelled();
+      });
+  for (auto it = cancelled; it != requests.end(); ++it) {
+    (*it)->promise.set_value(TokenBatch((*it)->tokens.size()));
+  }
+  requests.erase(cancelled, requests.end());
+  if (requests.empty()) {
+    return;
+  }
+
+  TokenBatch batch;
+  std::vector<const CancellationToken *> cancel;
+  bool any_cancel = false;
+  for (auto &request : requests) {
+    any_cancel = any_cancel || request->cancel;
+    for (auto &tokens : request->tokens) {
+      batch.push_back(std::move(tokens));
+      cancel.push_back(request->cancel.get());
+    }
+  }
+  if (!any_cancel) {
+    cancel.clear();
+  }
+
+  TokenBatch outputs;
+  auto start = std::chrono::steady_clock::now();
+  try {
+    outputs = translator->translate_tokens(batch, cancel);
+    if (outputs.size() != batch.size()) {
+      // Not a translation of this batch (e.g. the model is not loaded)
+      throw std::runtime_error("model returned " +
+                               std::to_string(outputs.size()) +
+                               " results for " + std::to_string(batch.size()) +
+                               " segments");
+    }
+  } catch (...) {
+    for (auto &request : requests) {
+      request->promise.set_exception(std::current_exception());
+    }
+    return;
+  }
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  size_t generated = 0;
+  for (const auto &tokens : outputs) {
+    generated += tokens.size();
+  }
+  PackageStats::GetInstance().RecordDecode(packageName, outputs.size(),
+                                           generated, elapsed.count());
+
+  // Split the results back to each caller
+  size_t offset = 0;
+  for (auto &request : requests) {
+    const size_t count = request->tokens.size();
+    request->promise.set_value(
+        TokenBatch(std::make_move_iterator(outputs.begin() + offset),
+                   std::make_move_iterator(outputs.begin() + offset + count)));
+    offset += count;
+  }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "translation_model.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BatchSchedulerOptions {
+  // How long the first queued request waits for others to join its batch.
+  // Zero submits as soon as the worker is free.
+  std::chrono::microseconds window{2000};
+  // Stop collecting once the batch holds this many source tokens
+  size_t max_batch_tokens = 2048;
+  // Stop collecting once the batch holds this many segments
+  size_t max_batch_segments = 64;
+};
+
+// Collects translate requests from concurrent callers of one model and
+// submits them together as a single translate_batch call, then hands each
+// caller back its own slice of the results.
+class BatchScheduler {
+public:
+  // package_name is used to record decode speed in PackageStats
+  BatchScheduler(std::shared_ptr<TranslationModel> translator,
+                 std::string package_name,
+                 const BatchSchedulerOptions &options = BatchSchedulerOptions());
+  ~BatchScheduler();
+
+  BatchScheduler(const BatchScheduler &) = delete;
+  BatchScheduler &operator=(const BatchScheduler &) = delete;
+
+  using TokenBatch = std::vector<std::vector<std::string>>;
+
+  // Queue tokenized segments for translation. The future resolves to the
+  // raw target tokens once the shared batch has been decoded. A request
+  // cancelled while queued resolves to empty outputs without decoding;
+  // cancelled mid-decode, it resolves to the partial outputs.
+  std::future<TokenBatch> Submit(TokenBatch batch,
+                                 CancellationTokenPtr cancel = nullptr);
+
+  // Blocking wrappers around Submit. Tokenization and detokenization run on
+  // the caller's thread so only decoding is serialized. With a cancel token
+  // they return (empty outputs) as soon as it fires, even while the request
+  // is still waiting behind another batch.
+  TokenBatch TranslateTokens(TokenBatch batch,
+                             CancellationTokenPtr cancel = nullptr);
+  std::vector<std::string> TranslateBatch(const std::vector<std::string> &texts,
+                                          CancellationTokenPtr cancel = nullptr);
+
+  TranslationModel &GetTranslator() { return *translator; }
+
+private:
+  struct Request {
+    TokenBatch tokens;
+    size_t token_count = 0;
+    std::chrono::steady_clock::time_point enqueued;
+    CancellationTokenPtr cancel;
+    std::promise<TokenBatch> promise;
+  };
+
+  void Run();
+  void Execute(std::vector<std::unique_ptr<Request>> &requests);
+
+  std::shared_ptr<TranslationModel> translator;
+  std::string packageName;
+  BatchSchedulerOptions options;
+
+  std::mutex queueMutex;
+  std::condition_variable queueCv;
+  std::deque<std::unique_ptr<Request>> queue;
+  size_t queuedTokens = 0;
+  size_t queuedSegments = 0;
+  bool stopping = false;
+  std::thread worker;
+};
@@ -0,0 +1,445 @@
+// Benchmarks that run without installed models
+#include "backend_scheduler.h"
+#include "bpe_rank_table.h"
+#include "document_translator.h"
+#include "language_graph.h"
+#include "mock_translator.h"
+#include "model_cache.h"
+#include "package_stats.h"
+#include "translation_backend.h"
+#include "translation_chain.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double to_ms(std::chrono::microseconds us) { return us.count() / 1000.0; }
+
+double elapsed_ms(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// Redirects std::cout/std::cerr into a buffer while alive, as the app's
+// LogCapture does, so chain logging costs what it costs in production and
+// does not interleave with the report
+class CaptureOutput {
+public:
+  CaptureOutput()
+      : out(std::cout.rdbuf(logs.rdbuf())),
+        err(std::cerr.rdbuf(logs.rdbuf())) {}
+  ~CaptureOutput() {
+    std::cout.rdbuf(out);
+    std::cerr.rdbuf(err);
+  }
+  std::string GetLogs() const { return logs.str(); }
+
+private:
+  std::stringstream logs;
+  std::streambuf *out;
+  std::streambuf *err;
+};
+
+std::ostringstream table;
+
+// One row of the report: wall time, time spent inside mock models and the
+// difference, which is the orchestration overhead
+void report(const std::string &name, size_t ops, double wall_ms,
+            double simulated_ms) {
+  const double overhead = wall_ms - simulated_ms;
+  table << std::left << std::setw(22) << name << std::right << std::fixed
+        << std::setprecision(2) << std::setw(8) << ops << std::setw(12)
+        << wall_ms << std::setw(12) << simulated_ms << std::setw(12) << overhead
+        << std::setw(12) << (ops ? overhead * 1000 / ops : 0) << std::endl;
+}
+
+// Synthetic package tree: empty model directories and one tokenizer file per
+// package, enough for routing and for the mock backend
+std::string create_packages(const std::filesystem::path &root) {
+  const char *pairs[] = {"de_en", "en_de", "en_es", "es_en", "fr_en", "en_fr"};
+  std::filesystem::path packages = root / "packages";
+  for (const char *pair : pairs) {
+    std::filesystem::path dir =
+        packages / ("translate-" + std::string(pair) + "-bench");
+    std::filesystem::create_directories(dir / "model");
+    std::ofstream(dir / "sentencepiece.model") << pair;
+  }
+  return packages.string();
+}
+
+// Stands in for an IO-bound backend such as Ollama: waits without using CPU
+class SleepBackend : public Backend {
+public:
+  explicit SleepBackend(std::chrono::milliseconds latency) : latency(latency) {}
+
+  std::string Kind() const override { return "io"; }
+
+  BackendResult Run(const std::string &input, const CancellationTokenPtr &,
+                    const ChunkCallback &) override {
+    std::this_thread::sleep_for(latency);
+    BackendResult result;
+    result.ok = true;
+    result.output = input;
+    return result;
+  }
+
+private:
+  std::chrono::milliseconds latency;
+};
+
+std::string make_sentence(size_t index, size_t words) {
+  std::string text;
+  for (size_t w = 0; w < words; w++) {
+    text += (w ? " word" : "Sentence") + std::to_string((index + w) % 97);
+  }
+  return text + ".";
+}
+
+int run_orchestration(int argc, char *argv[]) {
+  MockTranslatorOptions mock;
+  mock.load_latency = std::chrono::milliseconds(200);
+  mock.step_latency = std::chrono::microseconds(500);
+  mock.segment_latency = std::chrono::microseconds(20);
+  size_t iterations = 200;
+  size_t callers = 8;
+  size_t segments = 256;
+  std::chrono::milliseconds io_latency(20);
+
+  for (int i = 2; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    long value = std::max(0L, std::atol(argv[i + 1]));
+    if (arg == "--load-ms") {
+      mock.load_latency = std::chrono::milliseconds(value);
+    } else if (arg == "--step-us") {
+      mock.step_latency = std::chrono::microseconds(value);
+    } else if (arg == "--segment-us") {
+      mock.segment_latency = std::chrono::microseconds(value);
+    } else if (arg == "--iterations") {
+      iterations = std::max(1L, value);
+    } else if (arg == "--callers") {
+      callers = std::max(1L, value);
+    } else if (arg == "--segments") {
+      segments = std::max(1L, value);
+    } else if (arg == "--io-ms") {
+      io_latency = std::chrono::milliseconds(value);
+    } else {
+      std::cerr << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  const auto stamp = Clock::now().time_since_epoch().count();
+  std::filesystem::path root =
+      std::filesystem::temp_directory_path() /
+      ("fast-translator-bench-" + std::to_string(stamp));
+  const std::string packages_dir = create_packages(root);
+
+  auto capture = std::make_unique<CaptureOutput>();
+  ModelCache &cache = ModelCache::GetInstance();
+  cache.SetModelFactory(
+      [mock] { return std::make_shared<MockTranslator>(mock); });
+  PackageStats::GetInstance().SetRecording(false);
+
+  table << std::left << std::setw(22) << "scenario" << std::right
+        << std::setw(8) << "ops" << std::setw(12) << "wall ms" << std::setw(12)
+        << "model ms" << std::setw(12) << "overhead" << std::setw(12)
+        << "us/op" << std::endl;
+
+  // Routing: build the graph from disk and search it
+  {
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+      LanguageGraph graph;
+      graph.BuildFromPackages(packages_dir);
+      graph.FindPath("de", "fr");
+    }
+    report("route", iterations, elapsed_ms(start), 0);
+  }
+
+  // Cold chain load (two hops) and warm reload from the cache
+  TranslationChain chain;
+  const std::vector<std::string> route = {"de", "en", "es"};
+  for (const char *name : {"load cold", "load warm"}) {
+    MockTranslator::ResetSimulatedTime();
+    auto start = Clock::now();
+    if (!chain.Load(packages_dir, route)) {
+      std::string logs = capture->GetLogs();
+      capture.reset();
+      std::cerr << logs << "[ERROR] " << chain.GetError() << std::endl;
+      std::filesystem::remove_all(root);
+      return 1;
+    }
+    report(name, 1, elapsed_ms(start),
+           to_ms(MockTranslator::GetSimulatedTime()));
+  }
+
+  // Hotkey flow: one short sentence at a time through both hops
+  {
+    MockTranslator::ResetSimulatedTime();
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+      chain.Translate(make_sentence(i, 12));
+    }
+    report("hotkey", iterations, elapsed_ms(start),
+           to_ms(MockTranslator::GetSimulatedTime()));
+  }
+
+  // One large batch with some repeated segments
+  {
+    std::vector<std::string> texts;
+    for (size_t i = 0; i < segments; i++) {
+      texts.push_back(make_sentence(i % (segments / 2 + 1), 16));
+    }
+    MockTranslator::ResetSimulatedTime();
+    auto start = Clock::now();
+    chain.TranslateBatch(texts);
+    report("batch", segments, elapsed_ms(start),
+           to_ms(MockTranslator::GetSimulatedTime()));
+  }
+
+  // Concurrent callers sharing the cached models; their requests coalesce,
+  // so model time is counted once per shared batch
+  {
+    MockTranslator::ResetSimulatedTime();
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    const size_t per_caller = std::max<size_t>(1, iterations / callers);
+    for (size_t c = 0; c < callers; c++) {
+      threads.emplace_back([&, c] {
+        TranslationChain own;
+        own.Load(packages_dir, route);
+        for (size_t i = 0; i < per_caller; i++) {
+          own.Translate(make_sentence(c * per_caller + i, 12));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    report("concurrent", callers * per_caller, elapsed_ms(start),
+           to_ms(MockTranslator::GetSimulatedTime()));
+  }
+
+  // Streaming document translation with checkpoints
+  {
+    const std::string input = (root / "document.txt").string();
+    const std::string output = (root / "document.out").string();
+    {
+      std::ofstream doc(input);
+      for (size_t i = 0; i < segments; i++) {
+        doc << make_sentence(i, 20) << ' ' << make_sentence(i + 1, 8) << '\n';
+      }
+    }
+    MockTranslator::ResetSimulatedTime();
+    auto start = Clock::now();
+    TranslateDocument(input, output, chain);
+    report("document", segments, elapsed_ms(start),
+           to_ms(MockTranslator::GetSimulatedTime()));
+  }
+
+  // Translation jobs and IO-bound jobs through the backend scheduler, first
+  // one at a time, then all submitted together so the lanes overlap
+  {
+    BackendScheduler &scheduler = BackendScheduler::GetInstance();
+    auto translation =
+        std::make_shared<TranslationBackend>(packages_dir, route);
+    auto io = std::make_shared<SleepBackend>(io_latency);
+    const size_t per_kind = std::max<size_t>(1, callers);
+
+    MockTranslator::ResetSimulatedTime();
+    auto start = Clock::now();
+    for (size_t i = 0; i < per_kind; i++) {
+      scheduler.Run(translation, make_sentence(i, 12));
+      scheduler.Run(io, make_sentence(i, 12));
+    }
+    report("backends serial", 2 * per_kind, elapsed_ms(start),
+           to_ms(MockTranslator::GetSimulatedTime()));
+
+    MockTranslator::ResetSimulatedTime();
+    start = Clock::now();
+    std::vector<std::future<BackendResult>> results;
+    for (size_t i = 0; i < per_kind; i++) {
+      results.push_back(scheduler.Submit(translation, make_sentence(i, 12)));
+      results.push_back(scheduler.Submit(io, make_sentence(i, 12)));
+    }
+    for (auto &result : results) {
+      result.get();
+    }
+    report("backends mixed", 2 * per_kind, elapsed_ms(start),
+           to_ms(MockTranslator::GetSimulatedTime()));
+  }
+
+  cache.Clear();
+  capture.reset();
+  std::filesystem::remove_all(root);
+  std::cout << table.str();
+  return 0;
+}
+
+// The rank map LegacyBPETokenizer used before interning: string pairs
+// hashed by XOR, so (a, b), (b, a) and every (a, a) collide
+struct XorPairHash {
+  size_t operator()(const std::pair<std::string, std::string> &p) const {
+    return std::hash<std::string>{}(p.first) ^
+           std::hash<std::string>{}(p.second);
+  }
+};
+
+// Lookups per second of each BPE merge-rank structure over the same pairs,
+// half of them present. Merges are synthetic, with a share of symmetric and
+// doubled pairs like real merge tables ("e e", "s t" and "t s").
+int run_bpe_ranks(int argc, char *argv[]) {
+  size_t merge_count = 40000;
+  size_t lookups = 4000000;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    long value = std::max(1L, std::atol(argv[i + 1]));
+    if (arg == "--merges") {
+      merge_count = value;
+    } else if (arg == "--lookups") {
+      lookups = value;
+    } else {
+      std::cerr << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::mt19937 rng(42);
+  const size_t symbol_count = merge_count / 2 + 64;
+  std::vector<std::string> symbols;
+  for (size_t i = 0; i < symbol_count; i++) {
+    std::string symbol;
+    const size_t length = 1 + rng() % 6;
+    for (size_t c = 0; c < length; c++) {
+      symbol += static_cast<char>('a' + rng() % 26);
+    }
+    symbols.push_back(symbol + std::to_string(i));
+  }
+
+  std::vector<std::pair<int, int>> pairs;
+  while (pairs.size() < merge_count * 2) {
+    const int left = static_cast<int>(rng() % symbol_count);
+    const int right = static_cast<int>(rng() % symbol_count);
+    pairs.emplace_back(left, right);
+    if (rng() % 8 == 0) {
+      pairs.emplace_back(right, left);
+    } else if (rng() % 8 == 0) {
+      pairs.emplace_back(left, left);
+    }
+  }
+  // First half are merges, the rest only queried
+  const std::vector<std::pair<int, int>> merges(pairs.begin(),
+                                                pairs.begin() + merge_count);
+
+  std::unordered_map<std::pair<std::string, std::string>, int, XorPairHash>
+      string_map;
+  std::unordered_map<uint64_t, BpeMerge> id_map;
+  std::vector<std::pair<uint64_t, BpeMerge>> entries;
+  for (size_t rank = 0; rank < merges.size(); rank++) {
+    const auto [left, right] = merges[rank];
+    const BpeMerge merge{static_cast<int32_t>(rank), left};
+    string_map[{symbols[left], symbols[right]}] = merge.rank;
+    id_map[BpeRankTable::PairKey(left, right)] = merge;
+    entries.emplace_back(BpeRankTable::PairKey(left, right), merge);
+  }
+  std::vector<std::pair<uint64_t, BpeMerge>> sorted = entries;
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  const std::vector<BpeRankTable::Slot> slots = BpeRankTable::Build(entries);
+  BpeRankTable ranks;
+  ranks.Attach(slots.data(), slots.size());
+
+  std::vector<std::pair<std::string, std::string>> string_queries;
+  std::vector<uint64_t> key_queries;
+  for (size_t i = 0; i < lookups; i++) {
+    const auto [left, right] = pairs[rng() % pairs.size()];
+    key_queries.push_back(BpeRankTable::PairKey(left, right));
+    // The XOR map is slow enough that a sample of queries says it all
+    if (string_queries.size() < std::min<size_t>(lookups, 100000)) {
+      string_queries.emplace_back(symbols[left], symbols[right]);
+    }
+  }
+
+  table << std::left << std::setw(22) << "rank table" << std::right
+        << std::setw(12) << "lookups" << std::setw(10) << "hit %"
+        << std::setw(12) << "ms" << std::setw(14) << "M lookups/s"
+        << std::endl;
+  auto run = [&](const std::string &name, size_t count, auto &&find) {
+    size_t hits = 0;
+    const auto start = Clock::now();
+    for (size_t i = 0; i < count; i++) {
+      hits += find(i) ? 1 : 0;
+    }
+    const double ms = elapsed_ms(start);
+    table << std::left << std::setw(22) << name << std::right << std::fixed
+          << std::setprecision(2) << std::setw(12) << count << std::setw(10)
+          << hits * 100 / count << std::setw(12) << ms << std::setw(14)
+          << count / ms / 1000 << std::endl;
+  };
+
+  run("string pair xor-hash", string_queries.size(), [&](size_t i) {
+    return string_map.find(string_queries[i]) != string_map.end();
+  });
+  run("id pair unordered_map", key_queries.size(), [&](size_t i) {
+    return id_map.find(key_queries[i]) != id_map.end();
+  });
+  run("id pair sorted array", key_queries.size(), [&](size_t i) {
+    auto it = std::lower_bound(
+        sorted.begin(), sorted.end(), key_queries[i],
+        [](const auto &entry, uint64_t key) { return entry.first < key; });
+    return it != sorted.end() && it->first == key_queries[i];
+  });
+  run("flat rank table", key_queries.size(), [&](size_t i) {
+    BpeMerge merge;
+    return ranks.Find(key_queries[i], merge);
+  });
+
+  std::cout << table.str();
+  return 0;
+}
+
+void print_usage() {
+  std::cerr << "Usage: fast-translator-bench <benchmark> [options]\n"
+            << "Benchmarks:\n"
+            << "  orchestration  Routing, chaining, batching and caching over\n"
+            << "                 mock models\n"
+            << "                 [--load-ms N] [--step-us N] [--segment-us N]\n"
+            << "                 [--iterations N] [--callers N]\n"
+            << "                 [--segments N] [--io-ms N]\n"
+            << "  bpe-ranks      Lookups/s of BPE merge-rank tables\n"
+            << "                 [--merges N] [--lookups N]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    print_usage();
+    return 1;
+  }
+
+  std::string benchmark = argv[1];
+  if (benchmark == "orchestration") {
+    return run_orchestration(argc, argv);
+  }
+  if (benchmark == "bpe-ranks") {
+    return run_bpe_ranks(argc, argv);
+  }
+
+  print_usage();
+  return 1;
+}
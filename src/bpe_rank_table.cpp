@@ -0,0 +1,33 @@
+#include "bpe_rank_table.h"
+
+static_assert(sizeof(BpeRankTable::Slot) == 16, "Slots must be packed");
+
+std::vector<BpeRankTable::Slot>
+BpeRankTable::Build(const std::vector<std::pair<uint64_t, BpeMerge>> &entries) {
+  size_t slot_count = 16;
+  while (slot_count < entries.size() * 2) {
+    slot_count *= 2;
+  }
+  std::vector<Slot> table(slot_count, Slot{kEmptyKey, {0, 0}});
+  const uint64_t table_mask = slot_count - 1;
+  for (const auto &[key, merge] : entries) {
+    uint64_t i = Mix(key) & table_mask;
+    while (table[i].key != kEmptyKey && table[i].key != key) {
+      i = (i + 1) & table_mask;
+    }
+    table[i] = Slot{key, merge};
+  }
+  return table;
+}
+
+bool BpeRankTable::Attach(const void *table, size_t slot_count) {
+  if (slot_count == 0 || (slot_count & (slot_count - 1)) != 0 ||
+      reinterpret_cast<uintptr_t>(table) % alignof(Slot) != 0) {
+    slots = nullptr;
+    mask = 0;
+    return false;
+  }
+  slots = static_cast<const Slot *>(table);
+  mask = slot_count - 1;
+  return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// What merging an adjacent pair of BPE symbols produces
+struct BpeMerge {
+  int32_t rank;
+  int32_t merged; // Symbol id of the concatenation
+};
+
+// Flat open-addressing table from a (left, right) symbol-id pair to its
+// merge, usable in place from a mapped file. The pair is packed into one
+// 64-bit key and scattered with a full-avalanche mix, so (a, b), (b, a) and
+// (a, a) land in unrelated slots, unlike with a XOR of two string hashes.
+// A lookup is one hash and usually a single 16-byte slot, with no pointers
+// to follow.
+class BpeRankTable {
+public:
+  struct Slot {
+    uint64_t key; // kEmptyKey in unused slots
+    BpeMerge merge;
+  };
+  static const uint64_t kEmptyKey = ~uint64_t(0);
+
+  // Symbol ids are below 2^31, so no pair packs to kEmptyKey
+  static uint64_t PairKey(int left, int right) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(left)) << 32) |
+           static_cast<uint32_t>(right);
+  }
+
+  // Slots holding entries, a power of two at most half full; later
+  // duplicates of a key replace earlier ones
+  static std::vector<Slot>
+  Build(const std::vector<std::pair<uint64_t, BpeMerge>> &entries);
+
+  // Look up in slots owned elsewhere (a mapped file or a Build result).
+  // Fails unless slot_count is a power of two and slots are aligned.
+  bool Attach(const void *slots, size_t slot_count);
+
+  bool Find(uint64_t key, BpeMerge &merge) const {
+    // Probes are bounded so a corrupt file cannot loop forever
+    uint64_t i = Mix(key) & mask;
+    for (uint64_t probes = 0; slots && probes <= mask; probes++) {
+      const Slot &slot = slots[i];
+      if (slot.key == key) {
+        merge = slot.merge;
+        return true;
+      }
+      if (slot.key == kEmptyKey) {
+        return false;
+      }
+      i = (i + 1) & mask;
+    }
+    return false;
+  }
+
+private:
+  // MurmurHash3 finalizer
+  static uint64_t Mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+  }
+
+  const Slot *slots = nullptr;
+  uint64_t mask = 0;
+};
@@ -0,0 +1,22 @@
+#include "cancellation.h"
+
+static int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void CancellationToken::SetDeadline(std::chrono::milliseconds timeout) {
+  deadline.store(
+      now_ns() +
+      std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count());
+}
+
+bool CancellationToken::DeadlinePassed() const {
+  const int64_t expires = deadline.load();
+  return expires != 0 && now_ns() >= expires;
+}
+
+bool CancellationToken::IsCancelled() const {
+  return cancelled.load() || DeadlinePassed();
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+// Cooperative cancellation shared by the caller and a running translation.
+// Decoding polls it between steps, so a cancelled or expired request stops
+// within one step and returns what has been generated so far.
+class CancellationToken {
+public:
+  // Safe to call from any thread or a signal handler
+  void Cancel() { cancelled.store(true); }
+
+  // Expire the token once timeout has passed from now
+  void SetDeadline(std::chrono::milliseconds timeout);
+
+  // True once cancelled or past the deadline
+  bool IsCancelled() const;
+  bool DeadlinePassed() const;
+
+private:
+  std::atomic<bool> cancelled{false};
+  // steady_clock time in nanoseconds, 0 when there is no deadline
+  std::atomic<int64_t> deadline{0};
+};
+
+using CancellationTokenPtr = std::shared_ptr<CancellationToken>;
@@ -0,0 +1,357 @@
+#include "document_translator.h"
+#include "json.hpp"
+#include "utils.h"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Reads a stream in fixed-size blocks and hands out lines, cutting lines
+// longer than max_unit at the last space so memory stays bounded.
+class UnitReader {
+public:
+  UnitReader(std::istream &in, size_t max_unit)
+      : in(in), max_unit(max_unit), buf(64 * 1024) {}
+
+  // Returns false once the stream is exhausted. was_cut is set when the line
+  // continues in the next unit.
+  bool Next(std::string &unit, bool &has_newline, bool &was_cut) {
+    unit.swap(carry);
+    carry.clear();
+    has_newline = false;
+    was_cut = false;
+
+    while (true) {
+      if (pos == len) {
+        in.read(buf.data(), buf.size());
+        len = static_cast<size_t>(in.gcount());
+        pos = 0;
+        if (len == 0) {
+          return !unit.empty();
+        }
+      }
+
+      const char *start = buf.data() + pos;
+      const char *nl =
+          static_cast<const char *>(std::memchr(start, '\n', len - pos));
+      size_t take = nl ? static_cast<size_t>(nl - start) : len - pos;
+
+      if (unit.size() + take <= max_unit) {
+        unit.append(start, take);
+        pos += take;
+        if (nl) {
+          pos++; // Consume '\n'
+          has_newline = true;
+          return true;
+        }
+        continue;
+      }
+
+      // Line too long: fill up to the limit and cut at the last space
+      take = max_unit - unit.size();
+      unit.append(start, take);
+      pos += take;
+
+      size_t cut = unit.find_last_of(' ');
+      if (cut != std::string::npos && cut > 0) {
+        carry = unit.substr(cut + 1);
+        unit.resize(cut + 1);
+      }
+      was_cut = true;
+      return true;
+    }
+  }
+
+private:
+  std::istream &in;
+  size_t max_unit;
+  std::vector<char> buf;
+  size_t pos = 0;
+  size_t len = 0;
+  std::string carry;
+};
+
+// One line (or piece of a long line) of the input document
+struct Unit {
+  std::string leading;               // Indentation, kept verbatim
+  std::vector<std::string> segments; // Sentences to translate
+  std::string verbatim;              // Whitespace-only lines
+  std::string line_end;              // "\n", "\r\n" or "" at the end
+  bool was_cut = false;
+  size_t input_bytes = 0;
+};
+
+void SplitLong(const std::string &sentence, size_t max_bytes,
+               std::vector<std::string> &out) {
+  size_t start = 0;
+  while (sentence.size() - start > max_bytes) {
+    size_t cut = sentence.find_last_of(' ', start + max_bytes);
+    if (cut == std::string::npos || cut <= start) {
+      cut = start + max_bytes;
+      // Do not cut inside a UTF-8 sequence
+      while (cut > start + 1 &&
+             (static_cast<unsigned char>(sentence[cut]) & 0xC0) == 0x80) {
+        cut--;
+      }
+    }
+    out.push_back(sentence.substr(start, cut - start));
+    start = sentence.find_first_not_of(' ', cut);
+    if (start == std::string::npos)
+      return;
+  }
+  out.push_back(sentence.substr(start));
+}
+
+// Split a line into sentences after '.', '!' or '?' followed by a space
+std::vector<std::string> SplitSentences(const std::string &text,
+                                        size_t max_bytes) {
+  std::vector<std::string> sentences;
+  size_t start = 0;
+  for (size_t i = 0; i < text.size(); i++) {
+    char c = text[i];
+    if ((c == '.' || c == '!' || c == '?') && i + 1 < text.size() &&
+        text[i + 1] == ' ') {
+      SplitLong(text.substr(start, i + 1 - start), max_bytes, sentences);
+      start = text.find_first_not_of(' ', i + 1);
+      if (start == std::string::npos)
+        return sentences;
+      i = start - 1;
+    }
+  }
+  if (start < text.size()) {
+    SplitLong(text.substr(start), max_bytes, sentences);
+  }
+  return sentences;
+}
+
+Unit MakeUnit(const std::string &line, bool has_newline, bool was_cut,
+              size_t max_segment) {
+  Unit unit;
+  unit.was_cut = was_cut;
+  unit.input_bytes = line.size() + (has_newline ? 1 : 0);
+
+  // Write back the input's own line ending, so CRLF files stay CRLF
+  size_t length = line.size();
+  if (has_newline) {
+    const bool crlf = length > 0 && line[length - 1] == '\r';
+    length -= crlf ? 1 : 0;
+    unit.line_end = crlf ? "\r\n" : "\n";
+  }
+
+  const auto begin = line.find_first_not_of(" \t\r");
+  if (begin == std::string::npos) {
+    unit.verbatim = line.substr(0, length);
+    return unit;
+  }
+  const auto end = line.find_last_not_of(" \t\r", length - 1);
+  unit.leading = line.substr(0, begin);
+  unit.segments =
+      SplitSentences(line.substr(begin, end - begin + 1), max_segment);
+  return unit;
+}
+
+struct Checkpoint {
+  std::string input;
+  std::string route; // TranslationChain::GetRouteId()
+  uintmax_t input_size = 0;
+  int64_t input_mtime = 0; // last_write_time() ticks since the epoch
+  uintmax_t input_offset = 0;
+  uintmax_t output_offset = 0;
+};
+
+bool LoadCheckpoint(const std::string &path, Checkpoint &checkpoint) {
+  if (!std::filesystem::exists(path))
+    return false;
+  try {
+    std::ifstream f(path);
+    json data = json::parse(f);
+    checkpoint.input = data.value("input", "");
+    checkpoint.route = data.value("route", "");
+    checkpoint.input_size = data.value("input_size", uintmax_t(0));
+    checkpoint.input_mtime = data.value("input_mtime", int64_t(0));
+    checkpoint.input_offset = data.value("input_offset", uintmax_t(0));
+    checkpoint.output_offset = data.value("output_offset", uintmax_t(0));
+    return true;
+  } catch (const std::exception &e) {
+    std::cerr << "[WARNING] Ignoring unreadable checkpoint " << path << ": "
+              << e.what() << std::endl;
+    return false;
+  }
+}
+
+void SaveCheckpoint(const std::string &path, const Checkpoint &checkpoint) {
+  json data;
+  data["input"] = checkpoint.input;
+  data["route"] = checkpoint.route;
+  data["input_size"] = checkpoint.input_size;
+  data["input_mtime"] = checkpoint.input_mtime;
+  data["input_offset"] = checkpoint.input_offset;
+  data["output_offset"] = checkpoint.output_offset;
+
+  // Write a file of our own then rename it, so neither an interruption nor
+  // another process translating to the same output leaves a torn checkpoint
+  const std::string tmp = unique_temp_path(path);
+  {
+    std::ofstream f(tmp, std::ios::trunc);
+    f << data.dump();
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    std::cerr << "[WARNING] Failed to write checkpoint: " << ec.message()
+              << std::endl;
+    std::filesystem::remove(tmp, ec);
+  }
+}
+
+} // namespace
+
+std::string GetDocumentCheckpointPath(const std::string &output_path) {
+  return output_path + ".progress";
+}
+
+bool TranslateDocument(const std::string &input_path,
+                       const std::string &output_path, TranslationChain &chain,
+                       const DocumentOptions &options) {
+  std::error_code ec;
+  const uintmax_t input_size = std::filesystem::file_size(input_path, ec);
+  if (ec) {
+    std::cerr << "[ERROR] Cannot read input file " << input_path << ": "
+              << ec.message() << std::endl;
+    return false;
+  }
+  const auto input_mtime =
+      std::filesystem::last_write_time(input_path, ec).time_since_epoch();
+  if (ec) {
+    std::cerr << "[ERROR] Cannot read input file " << input_path << ": "
+              << ec.message() << std::endl;
+    return false;
+  }
+
+  std::ifstream in(input_path, std::ios::binary);
+  if (!in.is_open()) {
+    std::cerr << "[ERROR] Cannot open input file " << input_path << std::endl;
+    return false;
+  }
+
+  const std::string checkpoint_path = GetDocumentCheckpointPath(output_path);
+  Checkpoint checkpoint;
+  checkpoint.input = std::filesystem::absolute(input_path).string();
+  checkpoint.input_size = input_size;
+  checkpoint.input_mtime = static_cast<int64_t>(input_mtime.count());
+  checkpoint.route = chain.GetRouteId();
+
+  // Resume if a checkpoint for this exact input and route exists; output of
+  // another route (e.g. a different target language) is overwritten. The
+  // mtime catches inputs edited in place without changing size.
+  Checkpoint saved;
+  const bool same_input = LoadCheckpoint(checkpoint_path, saved) &&
+                          saved.input == checkpoint.input &&
+                          saved.input_size == input_size &&
+                          saved.input_mtime == checkpoint.input_mtime;
+  if (same_input && saved.route != checkpoint.route) {
+    std::cerr << "[Info] " << output_path << " holds a partial translation "
+              << "by another route (" << saved.route << "); starting over"
+              << std::endl;
+  }
+  bool resume = same_input && saved.route == checkpoint.route &&
+                std::filesystem::exists(output_path) &&
+                std::filesystem::file_size(output_path) >= saved.output_offset;
+
+  if (resume) {
+    checkpoint.input_offset = saved.input_offset;
+    checkpoint.output_offset = saved.output_offset;
+    // Drop any output written after the last checkpoint
+    std::filesystem::resize_file(output_path, checkpoint.output_offset);
+    in.seekg(static_cast<std::streamoff>(checkpoint.input_offset));
+    std::cerr << "[Info] Resuming " << input_path << " at byte "
+              << checkpoint.input_offset << " of " << input_size << std::endl;
+  }
+
+  std::ofstream out(output_path, std::ios::binary | (resume ? std::ios::app
+                                                            : std::ios::trunc));
+  if (!out.is_open()) {
+    std::cerr << "[ERROR] Cannot open output file " << output_path
+              << std::endl;
+    return false;
+  }
+
+  UnitReader reader(in, options.max_unit_bytes);
+  std::vector<Unit> units;
+  std::vector<std::string> segments;
+  std::string line;
+  bool has_newline = false;
+  bool was_cut = false;
+  bool more = true;
+  std::string chunk;
+
+  while (more) {
+    // Collect a batch of whole lines
+    units.clear();
+    segments.clear();
+    while (segments.size() < options.batch_segments &&
+           (more = reader.Next(line, has_newline, was_cut))) {
+      units.push_back(
+          MakeUnit(line, has_newline, was_cut, options.max_segment_bytes));
+      segments.insert(segments.end(), units.back().segments.begin(),
+                      units.back().segments.end());
+    }
+    if (units.empty())
+      break;
+
+    std::vector<std::string> translated;
+    if (!segments.empty()) {
+      translated = chain.TranslateBatch(segments);
+      if (!chain.GetError().empty()) {
+        // The checkpoint stays before this batch, so a rerun retries it
+        std::cerr << "[ERROR] Translation batch failed at byte "
+                  << checkpoint.input_offset << ": " << chain.GetError()
+                  << std::endl;
+        return false;
+      }
+    }
+
+    // Write in input order
+    chunk.clear();
+    size_t next = 0;
+    for (const auto &unit : units) {
+      if (unit.segments.empty()) {
+        chunk += unit.verbatim;
+      } else {
+        chunk += unit.leading;
+        for (size_t i = 0; i < unit.segments.size(); i++) {
+          if (i > 0)
+            chunk += ' ';
+          chunk += translated[next++];
+        }
+        // Lines cut for length continue in the next unit
+        if (unit.was_cut)
+          chunk += ' ';
+      }
+      chunk += unit.line_end;
+      checkpoint.input_offset += unit.input_bytes;
+    }
+
+    out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    out.flush();
+    if (!out) {
+      std::cerr << "[ERROR] Failed writing " << output_path << std::endl;
+      return false;
+    }
+    checkpoint.output_offset += chunk.size();
+    SaveCheckpoint(checkpoint_path, checkpoint);
+
+    std::cerr << "[Info] Translated " << checkpoint.input_offset << " / "
+              << input_size << " bytes" << std::endl;
+  }
+
+  out.close();
+  std::filesystem::remove(checkpoint_path, ec);
+  return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "translation_chain.h"
+#include <cstddef>
+#include <string>
+
+struct DocumentOptions {
+  // Segments sent to the chain per translate_batch call
+  size_t batch_segments = 32;
+  // Longest piece of a single line held in memory; longer lines are cut at
+  // the last space before this limit
+  size_t max_unit_bytes = 64 * 1024;
+  // Sentences longer than this are further split at whitespace
+  size_t max_segment_bytes = 1024;
+};
+
+// Checkpoint written next to the output file while a document is translated
+std::string GetDocumentCheckpointPath(const std::string &output_path);
+
+// Stream input_path through the chain line by line and write the translation
+// to output_path in order. Memory use is bounded by one batch of segments.
+// Progress is checkpointed after every batch; if a checkpoint for the same
+// input and route exists, translation resumes from it instead of starting
+// over.
+bool TranslateDocument(const std::string &input_path,
+                       const std::string &output_path, TranslationChain &chain,
+                       const DocumentOptions &options = DocumentOptions());
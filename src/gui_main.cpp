@@ -1,5 +1,6 @@
 #include "json.hpp" // Local JSON library
 #include "ollama.h"
+#include "package_installer.h"
 #include "role_manager.h"
 #include <filesystem>
 #include <fstream>
@@ -732,17 +733,15 @@ void MainFrame::OnInstall(wxCommandEvent &event) {
     return;
   }
 
-  // 3. Unzip
-
-  // 3. Unzip
-  // argos models are zips that contain the model files. usually they unzip into
-  // a folder or current dir? Usually they unzip into a folder named after the
-  // package. logic varies. Let's unzip to packages/
-  std::string cmdUnzip = "unzip -o " + zipPath + " -d " + packagesDir;
-  if (system(cmdUnzip.c_str()) != 0) {
+  // 3. Unzip into packages/ and quantize the model to int8, once, so every
+  // later translation loads a quarter of the bytes
+  wxBeginBusyCursor();
+  std::string installedName;
+  if (!InstallPackageArchive(zipPath, packagesDir, true, installedName,
+                             error)) {
+    std::filesystem::remove(zipPath);
     wxEndBusyCursor();
-    wxMessageBox("Extraction failed (install 'unzip' on system).", "Error",
-                 wxOK | wxICON_ERROR);
+    wxMessageBox(error, "Error", wxOK | wxICON_ERROR);
     return;
   }
 
@@ -1,11 +1,17 @@
 #include "language_graph.h"
+#include "package_stats.h"
 #include <filesystem>
 #include <queue>
 #include <algorithm>
+#include <tuple>
+
+// Typical selection length used to weigh decode speed against load time
+static const double kExpectedTokens = 32;
 
 void LanguageGraph::BuildFromPackages(const std::string& packages_dir) {
     edges.clear();
     packages.clear();
+    packagesDir = packages_dir;
     
     if (!std::filesystem::exists(packages_dir)) {
         return;
@@ -56,26 +62,30 @@ std::vector<std::string> LanguageGraph::FindPath(const std::string& from, const
         return {from};
     }
     
-    // BFS to find shortest path
-    std::queue<std::string> queue;
+    // Dijkstra over (cost, uncached hops, hops) so equally fast routes
+    // prefer packages that are already in memory, then fewer hops
+    using Distance = std::tuple<double, int, int>;
+    using Entry = std::pair<Distance, std::string>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    std::map<std::string, Distance> best;
     std::map<std::string, std::string> parent; // child -> parent
-    std::set<std::string> visited;
     
-    queue.push(from);
-    visited.insert(from);
-    parent[from] = "";
+    best[from] = Distance{0.0, 0, 0};
+    queue.push({best[from], from});
     
     while (!queue.empty()) {
-        std::string current = queue.front();
+        auto [distance, current] = queue.top();
         queue.pop();
         
+        if (distance > best[current]) continue; // Stale entry
+        
         if (current == to) {
             // Reconstruct path
             std::vector<std::string> path;
             std::string node = to;
             while (!node.empty()) {
                 path.push_back(node);
-                node = parent[node];
+                node = parent.count(node) ? parent[node] : "";
             }
             std::reverse(path.begin(), path.end());
             return path;
@@ -84,10 +94,16 @@ std::vector<std::string> LanguageGraph::FindPath(const std::string& from, const
         // Explore neighbors
         if (edges.count(current)) {
             for (const auto& neighbor : edges[current]) {
-                if (visited.find(neighbor) == visited.end()) {
-                    visited.insert(neighbor);
+                const std::string& pkg_name = packages[{current, neighbor}];
+                Distance next{std::get<0>(distance) + GetEdgeCost(pkg_name),
+                              std::get<1>(distance) + (cachedPackages.count(pkg_name) ? 0 : 1),
+                              std::get<2>(distance) + 1};
+                
+                auto it = best.find(neighbor);
+                if (it == best.end() || next < it->second) {
+                    best[neighbor] = next;
                     parent[neighbor] = current;
-                    queue.push(neighbor);
+                    queue.push({next, neighbor});
                 }
             }
         }
@@ -97,6 +113,33 @@ std::vector<std::string> LanguageGraph::FindPath(const std::string& from, const
     return {};
 }
 
+void LanguageGraph::SetCachedPackages(const std::set<std::string>& package_names) {
+    cachedPackages = package_names;
+}
+
+double LanguageGraph::GetEdgeCost(const std::string& pkg_name) const {
+    double load_ms = 0;
+    double ms_per_token = 0;
+    
+    PackageTiming timing;
+    if (PackageStats::GetInstance().GetTiming(pkg_name, timing)) {
+        load_ms = timing.load_ms;
+        ms_per_token = timing.ms_per_token;
+    } else {
+        // Not measured yet: estimate from the size of the model weights
+        std::error_code ec;
+        auto bytes = std::filesystem::file_size(packagesDir + "/" + pkg_name + "/model/model.bin", ec);
+        double size_mb = ec ? 100.0 : static_cast<double>(bytes) / (1024 * 1024);
+        load_ms = 4.0 * size_mb;
+        ms_per_token = 0.05 * size_mb;
+    }
+    
+    if (cachedPackages.count(pkg_name)) {
+        load_ms = 0;
+    }
+    return load_ms + ms_per_token * kExpectedTokens;
+}
+
 std::set<std::string> LanguageGraph::GetAllLanguages() const {
     std::set<std::string> languages;
     
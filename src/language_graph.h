@@ -10,9 +10,14 @@ public:
     // Build graph from installed packages directory
     void BuildFromPackages(const std::string& packages_dir);
     
-    // Find shortest path from source to target language
+    // Find the fastest path from source to target language, weighting each
+    // hop by its package's measured load time and decode speed
     // Returns empty vector if no path exists
     std::vector<std::string> FindPath(const std::string& from, const std::string& to);
+
+    // Packages already loaded in this process; they cost no load time and
+    // win ties against packages that would have to be loaded
+    void SetCachedPackages(const std::set<std::string>& package_names);
     
     // Get all unique languages available
     std::set<std::string> GetAllLanguages() const;
@@ -24,6 +29,12 @@ public:
     bool HasDirectPath(const std::string& from, const std::string& to) const;
 
 private:
+    // Expected milliseconds to run one hop with the given package
+    double GetEdgeCost(const std::string& pkg_name) const;
+
+    std::string packagesDir;
+    std::set<std::string> cachedPackages;
+
     // Adjacency list: from_lang -> [to_langs]
     std::map<std::string, std::vector<std::string>> edges;
     
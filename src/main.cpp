@@ -5,12 +5,21 @@
 #include <vector>
 // #include <ctranslate2/translator.h> // Hidden in translation.h
 // #include <sentencepiece_processor.h>
+#include "backend_scheduler.h"
 #include "language_graph.h"
-#include "ollama.h"
+#include "mock_translator.h"
+#include "model_cache.h"
+#include "ollama_backend.h"
+#include "package_stats.h"
 #include "response_processor.h"
+#include "document_translator.h"
 #include "role_manager.h"
+#include "subtitle_translator.h"
 #include "translation.h"
+#include "translation_backend.h"
+#include "translation_chain.h"
 #include "utils.h"
+#include "word_dictionary.h"
 #ifdef _WIN32
 #include <windows.h>
 #define PATH_MAX MAX_PATH
@@ -23,8 +32,12 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 
 std::string get_executable_dir() {
   char buf[PATH_MAX];
@@ -66,8 +79,360 @@ struct LogCapture {
   std::string get_logs() { return buffer.str(); }
 };
 
+// Locate the installed packages folder next to the executable (or one level
+// up for development builds)
+std::string get_packages_dir() {
+  std::string exe_dir = get_executable_dir();
+  std::string packages_dir = exe_dir + "/packages";
+
+  if (!std::filesystem::exists(packages_dir)) {
+    std::string dev_packages = exe_dir + "/../packages";
+    if (std::filesystem::exists(dev_packages)) {
+      packages_dir = dev_packages;
+    }
+  }
+  return packages_dir;
+}
+
+// Parse an "xx:yy[:zz...]" route. When only source and target are given the
+// path is found automatically through the installed packages.
+bool resolve_route(const std::string &arg, const std::string &packages_dir,
+                   std::vector<std::string> &route) {
+  route.clear();
+  size_t pos = 0;
+  while (pos < arg.length()) {
+    size_t next_colon = arg.find(':', pos);
+    if (next_colon == std::string::npos) {
+      route.push_back(arg.substr(pos));
+      break;
+    } else {
+      route.push_back(arg.substr(pos, next_colon - pos));
+      pos = next_colon + 1;
+    }
+  }
+
+  if (route.size() != 2) {
+    return route.size() > 2;
+  }
+
+  LanguageGraph graph;
+  graph.BuildFromPackages(packages_dir);
+  graph.SetCachedPackages(ModelCache::GetInstance().GetLoadedPackages());
+
+  std::vector<std::string> path = graph.FindPath(route[0], route[1]);
+  if (path.empty()) {
+    std::cerr << "Error: No translation path from " << route[0] << " to "
+              << route[1] << std::endl;
+    return false;
+  }
+
+  route = path;
+  if (route.size() > 2) {
+    std::cout << "Auto-route (" << (route.size() - 1) << " hops): ";
+    for (size_t i = 0; i < route.size(); i++) {
+      std::cout << route[i];
+      if (i < route.size() - 1)
+        std::cout << " -> ";
+    }
+    std::cout << std::endl;
+  }
+  return true;
+}
+
+// A hotkey (clipboard) translation gives up after this long instead of
+// freezing the desktop; --timeout-ms overrides it and 0 disables it. Test,
+// document and subtitle runs have no limit unless one is given.
+static const int kDefaultTimeoutMs = 10000;
+
+// Token of the translation in progress, cancelled on SIGINT/SIGTERM so an
+// interrupted run still returns what was decoded
+static CancellationToken *active_cancel = nullptr;
+
+static void cancel_on_signal(int) {
+  if (active_cancel) {
+    active_cancel->Cancel();
+  }
+}
+
+static void cancel_on_signals(CancellationToken *cancel) {
+  active_cancel = cancel;
+  std::signal(SIGINT, cancel ? cancel_on_signal : SIG_DFL);
+  std::signal(SIGTERM, cancel ? cancel_on_signal : SIG_DFL);
+}
+
+// Remove "name value" from the arguments, wherever it appears, so the
+// positional parsing below is unaffected
+static bool take_option(int &argc, char *argv[], const std::string &name,
+                        std::string &value) {
+  for (int i = 1; i + 1 < argc; i++) {
+    if (name == argv[i]) {
+      value = argv[i + 1];
+      for (int j = i; j + 2 <= argc; j++) {
+        argv[j] = argv[j + 2];
+      }
+      argc -= 2;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Test mode input: the first line, or everything for markup documents
+static void read_stdin_text(bool all_lines, std::string &text) {
+  if (all_lines) {
+    text.assign(std::istreambuf_iterator<char>(std::cin),
+                std::istreambuf_iterator<char>());
+  } else {
+    std::getline(std::cin, text);
+  }
+}
+
+// -1 when --timeout-ms is not given
+static int take_timeout_arg(int &argc, char *argv[]) {
+  std::string value;
+  if (!take_option(argc, argv, "--timeout-ms", value)) {
+    return -1;
+  }
+  return std::max(0, std::atoi(value.c_str()));
+}
+
+// Document mode: --file in.txt --out out.txt --route de:en [--batch N]
+//                [--batch-window-ms N] [--chunk-tokens N]
+int run_document_mode(int argc, char *argv[]) {
+  std::string input_path;
+  std::string output_path;
+  std::string route_arg;
+  DocumentOptions options;
+
+  for (int i = 1; i < argc - 1; i++) {
+    std::string arg = argv[i];
+    if (arg == "--file") {
+      input_path = argv[++i];
+    } else if (arg == "--out") {
+      output_path = argv[++i];
+    } else if (arg == "--route") {
+      route_arg = argv[++i];
+    } else if (arg == "--batch") {
+      options.batch_segments = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--batch-window-ms") {
+      BatchSchedulerOptions scheduler_options;
+      scheduler_options.window =
+          std::chrono::milliseconds(std::max(0, std::atoi(argv[++i])));
+      ModelCache::GetInstance().SetSchedulerOptions(scheduler_options);
+    } else if (arg == "--chunk-tokens") {
+      // 0 (the default) leaves lines whole
+      ModelCache::GetInstance().SetMaxChunkTokens(
+          std::max(0, std::atoi(argv[++i])));
+    }
+  }
+
+  if (input_path.empty() || output_path.empty() ||
+      route_arg.find(':') == std::string::npos) {
+    std::cerr << "Usage: fast-translator --file in.txt --out out.txt --route "
+                 "de:en [--batch N] [--batch-window-ms N] [--chunk-tokens N]"
+              << std::endl;
+    return 1;
+  }
+
+  std::string packages_dir = get_packages_dir();
+  std::vector<std::string> route;
+  if (!resolve_route(route_arg, packages_dir, route)) {
+    return 1;
+  }
+
+  // Documents keep full batches in flight: use the whole CPU budget
+  ModelCache::GetInstance().SetWorkload(
+      Workload{options.max_segment_bytes / 4, options.batch_segments});
+
+  TranslationChain chain;
+  if (!chain.Load(packages_dir, route)) {
+    std::cerr << "[ERROR] " << chain.GetError() << std::endl;
+    return 1;
+  }
+
+  bool translated = TranslateDocument(input_path, output_path, chain, options);
+  PackageStats::GetInstance().Save();
+
+  if (!translated) {
+    std::cerr << "[ERROR] Document translation stopped. Run the same command "
+                 "again to resume."
+              << std::endl;
+    return 1;
+  }
+
+  std::cout << "Translated " << input_path << " -> " << output_path
+            << std::endl;
+  return 0;
+}
+
+// Subtitle mode: --subtitles in.srt --route en:es [--out out.srt]
+//                [--batch N]
+int run_subtitle_mode(int argc, char *argv[]) {
+  std::string input_path;
+  std::string output_path;
+  std::string route_arg;
+  SubtitleOptions options;
+
+  for (int i = 1; i < argc - 1; i++) {
+    std::string arg = argv[i];
+    if (arg == "--subtitles") {
+      input_path = argv[++i];
+    } else if (arg == "--out") {
+      output_path = argv[++i];
+    } else if (arg == "--route") {
+      route_arg = argv[++i];
+    } else if (arg == "--batch") {
+      options.batch_segments = std::max(1, std::atoi(argv[++i]));
+    }
+  }
+
+  if (input_path.empty() || route_arg.find(':') == std::string::npos) {
+    std::cerr << "Usage: fast-translator --subtitles in.srt --route en:es "
+                 "[--out out.srt] [--batch N]"
+              << std::endl;
+    return 1;
+  }
+
+  std::string packages_dir = get_packages_dir();
+  std::vector<std::string> route;
+  if (!resolve_route(route_arg, packages_dir, route)) {
+    return 1;
+  }
+
+  // movie.srt -> movie.es.srt
+  if (output_path.empty()) {
+    std::filesystem::path path(input_path);
+    output_path = (path.parent_path() / (path.stem().string() + "." +
+                                         route.back() +
+                                         path.extension().string()))
+                      .string();
+  }
+
+  // Merged cue sentences are a few dozen tokens, decoded in full batches
+  ModelCache::GetInstance().SetWorkload(Workload{32, options.batch_segments});
+
+  TranslationChain chain;
+  if (!chain.Load(packages_dir, route)) {
+    std::cerr << "[ERROR] " << chain.GetError() << std::endl;
+    return 1;
+  }
+
+  bool translated = TranslateSubtitles(input_path, output_path, chain, options);
+  PackageStats::GetInstance().Save();
+  if (!translated) {
+    return 1;
+  }
+
+  std::cout << "Translated " << input_path << " -> " << output_path
+            << std::endl;
+  return 0;
+}
+
+// Translate a single word through every hop of route using only package
+// dictionaries. Fails (so the caller falls back to the models) if any hop
+// has no dictionary or no entry.
+static bool lookup_word_along_route(const std::string &packages_dir,
+                                    const std::vector<std::string> &route,
+                                    const std::string &word,
+                                    std::string &translation) {
+  if (route.size() < 2) {
+    return false;
+  }
+
+  LanguageGraph graph;
+  graph.BuildFromPackages(packages_dir);
+
+  std::string current = word;
+  for (size_t i = 0; i + 1 < route.size(); i++) {
+    const std::string pkg_name = graph.GetPackagePath(route[i], route[i + 1]);
+    if (pkg_name.empty()) {
+      return false;
+    }
+    WordDictionary dictionary;
+    std::string next;
+    if (!dictionary.Open(GetDictionaryPath(
+            ResolvePackageFiles(packages_dir, pkg_name).dir)) ||
+        !dictionary.Lookup(current, next)) {
+      return false;
+    }
+    current = std::move(next);
+  }
+
+  translation = current;
+  return true;
+}
+
+// Translate text through the route with the neural models. Reports errors
+// to the user and returns false when there is nothing to paste.
+static bool translate_with_models(const std::string &packages_dir,
+                                  const std::vector<std::string> &route,
+                                  const std::string &input_text,
+                                  int timeout_ms, MarkupFormat format,
+                                  std::string &current_text) {
+  // Short selections decode fastest on one or two threads
+  ModelCache::GetInstance().SetWorkload(
+      Workload{EstimateTokens(input_text), 1});
+
+  BackendJobOptions options;
+  options.priority = BackendPriority::Interactive;
+  options.cancel = std::make_shared<CancellationToken>();
+  cancel_on_signals(options.cancel.get());
+
+  BackendResult result = BackendScheduler::GetInstance().Run(
+      std::make_shared<TranslationBackend>(
+          packages_dir, route, std::chrono::milliseconds(timeout_ms), format),
+      input_text, options);
+
+  cancel_on_signals(nullptr);
+
+  // Measured speeds feed the weighted routing of later runs
+  PackageStats::GetInstance().Save();
+
+  if (!result.ok) {
+    notify_user("Argos Error", result.error);
+    return false;
+  }
+  current_text = result.output;
+  std::cout << "  Result: " << current_text << std::endl;
+  if (result.partial) {
+    notify_user("Argos", result.error + ", result is partial");
+  }
+  return true;
+}
+
 int run_app(int argc, char *argv[]) {
 
+  // FAST_TRANSLATOR_BACKEND=mock exercises the whole flow with synthetic
+  // models; package directories must still exist for routing
+  const char *backend = std::getenv("FAST_TRANSLATOR_BACKEND");
+  if (backend && std::string(backend) == "mock") {
+    std::cerr << "[Info] Using mock translation backend" << std::endl;
+    ModelCache::GetInstance().SetModelFactory(
+        [] { return std::make_shared<MockTranslator>(); });
+    // Synthetic timings must not steer routing for the real models
+    PackageStats::GetInstance().SetRecording(false);
+  }
+
+  // Document and subtitle modes read and write files, never the clipboard
+  if (argc >= 2 && std::string(argv[1]) == "--file") {
+    return run_document_mode(argc, argv);
+  }
+  if (argc >= 2 && std::string(argv[1]) == "--subtitles") {
+    return run_subtitle_mode(argc, argv);
+  }
+
+  int timeout_ms = take_timeout_arg(argc, argv);
+
+  // --format markdown|html translates only the text between the markup
+  MarkupFormat format = MarkupFormat::Plain;
+  std::string format_name;
+  if (take_option(argc, argv, "--format", format_name) &&
+      !ParseMarkupFormat(format_name, format)) {
+    std::cerr << "[ERROR] Unknown format '" << format_name
+              << "' (use plain, markdown or html)" << std::endl;
+    return 1;
+  }
+
   // Check for test/debug mode (--test "text" lang:lang)
   // This mode works without X11/clipboard for SSH debugging
   bool test_mode = false;
@@ -96,7 +461,7 @@ int run_app(int argc, char *argv[]) {
     } else if (argc >= 3 && argv2_is_lang_code) {
       // Stdin form: echo "text" | fast-translator --test es:en
       std::cerr << "[DEBUG] Reading text from stdin..." << std::endl;
-      std::getline(std::cin, test_text);
+      read_stdin_text(format != MarkupFormat::Plain, test_text);
       arg_offset = 1; // Language is at argv[2], so offset is 1
     } else if (argc >= 3) {
       // Assume argv[2] is text without language (use default en:es)
@@ -105,7 +470,7 @@ int run_app(int argc, char *argv[]) {
     } else {
       // Read from stdin with no language arg
       std::cerr << "[DEBUG] Reading text from stdin..." << std::endl;
-      std::getline(std::cin, test_text);
+      read_stdin_text(format != MarkupFormat::Plain, test_text);
     }
 
     if (test_text.empty()) {
@@ -119,6 +484,10 @@ int run_app(int argc, char *argv[]) {
     std::cerr << "[DEBUG] Input text: \"" << test_text << "\"" << std::endl;
   }
 
+  if (timeout_ms < 0) {
+    timeout_ms = test_mode ? 0 : kDefaultTimeoutMs;
+  }
+
   // 1. Capture text from clipboard (or use test text)
   std::string input_text;
   if (test_mode) {
@@ -176,19 +545,32 @@ int run_app(int argc, char *argv[]) {
     }
 
     std::cerr << "[DEBUG] Sending query to Ollama..." << std::endl;
-    std::string response;
-
-    if (!role_prompt.empty()) {
-      response = query_ollama_with_role(model, input_text, role_prompt);
-    } else {
-      response = query_ollama(model, input_text);
+    BackendJobOptions options;
+    options.priority = BackendPriority::Interactive;
+    options.cancel = std::make_shared<CancellationToken>();
+    if (test_mode) {
+      // Show the answer as it is generated
+      options.on_chunk = [](const std::string &chunk) {
+        std::cout << chunk << std::flush;
+      };
     }
+    cancel_on_signals(options.cancel.get());
+    BackendResult result = BackendScheduler::GetInstance().Run(
+        std::make_shared<OllamaBackend>(model, role_prompt), input_text,
+        options);
+    cancel_on_signals(nullptr);
+    if (test_mode) {
+      std::cout << std::endl;
+    }
+
+    std::string response = result.output;
     std::cerr << "[DEBUG] Ollama response length: " << response.size()
               << std::endl;
 
-    if (response.find("Error:") == 0) {
-      std::cerr << "[ERROR] Ollama returned error: " << response << std::endl;
-      notify_user("Ollama Error", response);
+    if (!result.ok) {
+      std::cerr << "[ERROR] Ollama returned error: " << result.error
+                << std::endl;
+      notify_user("Ollama Error", "Error: " + result.error);
       return 1;
     }
 
@@ -221,27 +603,7 @@ int run_app(int argc, char *argv[]) {
   }
 
   // 2. Determine packages directory
-  std::string exe_dir = get_executable_dir();
-  std::string packages_dir = exe_dir + "/packages";
-
-  if (test_mode) {
-    std::cerr << "[DEBUG] exe_dir: " << exe_dir << std::endl;
-    std::cerr << "[DEBUG] Initial packages_dir: " << packages_dir << std::endl;
-    std::cerr << "[DEBUG] packages_dir exists: "
-              << (std::filesystem::exists(packages_dir) ? "YES" : "NO")
-              << std::endl;
-  }
-
-  if (!std::filesystem::exists(packages_dir)) {
-    std::string dev_packages = exe_dir + "/../packages";
-    if (std::filesystem::exists(dev_packages)) {
-      packages_dir = dev_packages;
-      if (test_mode) {
-        std::cerr << "[DEBUG] Using dev_packages: " << packages_dir
-                  << std::endl;
-      }
-    }
-  }
+  std::string packages_dir = get_packages_dir();
 
   if (test_mode) {
     std::cerr << "[DEBUG] Final packages_dir: " << packages_dir << std::endl;
@@ -271,145 +633,55 @@ int run_app(int argc, char *argv[]) {
               << std::endl;
   }
 
+  std::string route_arg;
   if (argc > lang_arg_idx) {
     std::string arg = argv[lang_arg_idx];
     if (arg.find(':') != std::string::npos) {
-      // Parse explicit chain
-      size_t pos = 0;
-      while (pos < arg.length()) {
-        size_t next_colon = arg.find(':', pos);
-        if (next_colon == std::string::npos) {
-          route.push_back(arg.substr(pos));
-          break;
-        } else {
-          route.push_back(arg.substr(pos, next_colon - pos));
-          pos = next_colon + 1;
-        }
-      }
-      std::cout << "Chain mode: ";
-      for (size_t i = 0; i < route.size(); i++) {
-        std::cout << route[i];
-        if (i < route.size() - 1)
-          std::cout << " -> ";
-      }
-      std::cout << std::endl;
+      // Explicit chain
+      route_arg = arg;
+      std::cout << "Chain mode: " << arg << std::endl;
     } else {
       // Legacy single-arg mode (backward compatibility)
       if (arg == "es") {
-        route = {"es", "en"};
+        route_arg = "es:en";
       } else {
         // Try to interpret as "from_code" (from -> en)
-        route = {arg, "en"};
+        route_arg = arg + ":en";
       }
     }
   } else {
     // Default: EN -> ES
-    route = {"en", "es"};
-  }
-
-  // If only source and target specified, find path automatically
-  if (route.size() == 2) {
-    LanguageGraph graph;
-    graph.BuildFromPackages(packages_dir);
-
-    std::vector<std::string> path = graph.FindPath(route[0], route[1]);
-    if (!path.empty()) {
-      route = path;
-      if (route.size() > 2) {
-        std::cout << "Auto-route (" << (route.size() - 1) << " hops): ";
-        for (size_t i = 0; i < route.size(); i++) {
-          std::cout << route[i];
-          if (i < route.size() - 1)
-            std::cout << " -> ";
-        }
-        std::cout << std::endl;
-      }
-    } else {
-      std::cerr << "Error: No translation path from " << route[0] << " to "
-                << route[1] << std::endl;
-      notify_user("Argos Error", "No translation path available");
-      return 1;
-    }
+    route_arg = "en:es";
   }
 
-  // 4. Execute translation chain
-  std::string current_text = input_text;
-
-  for (size_t i = 0; i < route.size() - 1; i++) {
-    std::string from_lang = route[i];
-    std::string to_lang = route[i + 1];
-
-    std::cout << "Hop " << (i + 1) << ": " << from_lang << " -> " << to_lang
-              << std::endl;
-
-    // Find package for this hop
-    LanguageGraph graph;
-    graph.BuildFromPackages(packages_dir);
-    std::string pkg_name = graph.GetPackagePath(from_lang, to_lang);
-
-    std::cerr << "[DEBUG] Hop " << (i + 1) << " package: " << pkg_name
-              << std::endl;
-
-    if (pkg_name.empty()) {
-      std::cerr << "Error: No package for " << from_lang << "->" << to_lang
-                << std::endl;
-      notify_user("Argos Error", "Missing translation package");
-      return 1;
-    }
-
-    // Determine model paths
-    std::string model_dir = packages_dir + "/" + pkg_name + "/model";
-    std::string sp_model =
-        packages_dir + "/" + pkg_name + "/sentencepiece.model";
-
-    // Try .bpe.model as fallback
-    if (!std::filesystem::exists(sp_model)) {
-      sp_model = packages_dir + "/" + pkg_name + "/bpe.model";
-    }
-
-    std::cout << "  Loading: " << pkg_name << std::endl;
-    std::cerr << "[DEBUG] Loading model from: " << model_dir << std::endl;
-
-    ArgosTranslator translator;
-    if (!translator.load_model(model_dir, sp_model)) {
-      std::cerr << "[ERROR] Failed to load model: " << pkg_name << std::endl;
-      notify_user("Argos Error", "Failed to load model: " + pkg_name);
-      return 1;
-    }
-
-    std::cerr << "[DEBUG] Model loaded. Translating..." << std::endl;
-
-    current_text = translator.translate(current_text);
-    std::cerr << "[DEBUG] Raw translation length: " << current_text.size()
-              << std::endl;
-
-    current_text = decode_html_entities(current_text);
-
-    // Clean SentencePiece artifacts (▁ = U+2581, UTF-8: E2 96 81)
-    std::string sp_marker = "\xE2\x96\x81"; // ▁
-    // Replace internal markers with spaces
-    size_t pos = 0;
-    while ((pos = current_text.find(sp_marker, pos)) != std::string::npos) {
-      if (pos == 0) {
-        // Remove leading marker
-        current_text.erase(pos, sp_marker.length());
-      } else {
-        // Replace with space
-        current_text.replace(pos, sp_marker.length(), " ");
-        pos += 1;
-      }
-    }
+  // If only source and target specified, the path is found automatically
+  if (!resolve_route(route_arg, packages_dir, route)) {
+    notify_user("Argos Error", "No translation path available");
+    return 1;
+  }
 
+  // 4. Execute translation chain
+  std::string current_text;
+  // Single words are answered from the package dictionaries when possible,
+  // before any model is loaded
+  if (format == MarkupFormat::Plain &&
+      input_text.find_first_of(" \t\n\r") == std::string::npos &&
+      lookup_word_along_route(packages_dir, route, input_text, current_text)) {
+    std::cerr << "[DEBUG] Dictionary hit, no model needed" << std::endl;
     std::cout << "  Result: " << current_text << std::endl;
-    std::cerr << "[DEBUG] Hop result: " << current_text << std::endl;
+  } else if (!translate_with_models(packages_dir, route, input_text,
+                                    timeout_ms, format, current_text)) {
+    return 1;
   }
 
   // 5. Post-process and output
-  // Remove trailing punctuation and whitespace more aggressively
+  // Remove trailing punctuation and whitespace more aggressively (markup
+  // documents keep their punctuation)
   while (!current_text.empty()) {
     char last = current_text.back();
-    if (std::isspace(last) || last == '.' || last == ',' || last == ';' ||
-        last == ':') {
+    if (std::isspace(last) ||
+        (format == MarkupFormat::Plain &&
+         (last == '.' || last == ',' || last == ';' || last == ':'))) {
       current_text.pop_back();
     } else {
       break;
@@ -0,0 +1,56 @@
+#include "mapped_file.h"
+#include <fstream>
+#include <iterator>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { Close(); }
+
+void MappedFile::Close() {
+#ifndef _WIN32
+  if (mapped && data) {
+    munmap(const_cast<char *>(data), size);
+  }
+#endif
+  data = nullptr;
+  size = 0;
+  mapped = false;
+  buffer.clear();
+}
+
+bool MappedFile::Open(const std::string &path) {
+  Close();
+
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *address = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                         MAP_SHARED, fd, 0);
+    if (address != MAP_FAILED) {
+      data = static_cast<const char *>(address);
+      size = static_cast<size_t>(st.st_size);
+      mapped = true;
+      // Lookups touch scattered pages; readahead would only waste memory
+      madvise(address, size, MADV_RANDOM);
+    }
+  }
+  close(fd);
+#else
+  std::ifstream file(path, std::ios::binary);
+  if (file) {
+    buffer.assign(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+  }
+#endif
+  return data != nullptr;
+}
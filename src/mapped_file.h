@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. On POSIX systems the file is mapped with
+// mmap, so callers that use the bytes in place (dictionaries, compiled BPE
+// tables) read the page cache directly instead of a private copy; elsewhere
+// it is read into memory.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool Open(const std::string &path);
+  void Close();
+
+  const char *Data() const { return data; }
+  size_t Size() const { return size; }
+  // False when the contents were read into a private buffer instead
+  bool IsMapped() const { return mapped; }
+
+private:
+  const char *data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  std::vector<char> buffer;
+};
@@ -0,0 +1,501 @@
+#include "markup_translator.h"
+#include "utils.h"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+namespace {
+
+// Collects pieces, merging neighbours of the same kind
+class PieceBuilder {
+public:
+  void Text(const std::string &text) { Append(text, true); }
+  void Text(char c) { Append(std::string(1, c), true); }
+  void Markup(const std::string &text) { Append(text, false); }
+
+  std::vector<MarkupPiece> Finish() { return std::move(pieces); }
+
+private:
+  void Append(const std::string &text, bool translate) {
+    if (text.empty()) {
+      return;
+    }
+    if (pieces.empty() || pieces.back().translate != translate) {
+      pieces.push_back(MarkupPiece{"", translate});
+    }
+    pieces.back().text += text;
+  }
+
+  std::vector<MarkupPiece> pieces;
+};
+
+bool is_alpha(char c) { return std::isalpha(static_cast<unsigned char>(c)); }
+bool is_alnum(char c) { return std::isalnum(static_cast<unsigned char>(c)); }
+bool is_digit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
+
+// Worth a model call: has an ASCII letter or any non-ASCII character
+bool has_letter(const std::string &text) {
+  return std::any_of(text.begin(), text.end(), [](char c) {
+    return is_alpha(c) || static_cast<unsigned char>(c) >= 0x80;
+  });
+}
+
+std::string ascii_lower(std::string text) {
+  for (char &c : text) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return text;
+}
+
+std::string escape_html(const std::string &text) {
+  std::string result;
+  result.reserve(text.size());
+  for (char c : text) {
+    switch (c) {
+    case '&':
+      result += "&amp;";
+      break;
+    case '<':
+      result += "&lt;";
+      break;
+    case '>':
+      result += "&gt;";
+      break;
+    default:
+      result += c;
+    }
+  }
+  return result;
+}
+
+// ---------------------------------------------------------------- HTML ---
+
+// Elements whose content is never prose
+const char *const kRawElements[] = {"script", "style", "pre", "code",
+                                    "textarea"};
+
+// Index just past the '>' closing the tag that starts at pos, skipping '>'
+// inside quoted attribute values; npos if unterminated
+size_t tag_end(const std::string &html, size_t pos) {
+  char quote = 0;
+  for (size_t i = pos + 1; i < html.size(); i++) {
+    const char c = html[i];
+    if (quote) {
+      if (c == quote) {
+        quote = 0;
+      }
+    } else if (c == '"' || c == '\'') {
+      quote = c;
+    } else if (c == '>') {
+      return i + 1;
+    }
+  }
+  return std::string::npos;
+}
+
+void split_html(const std::string &html, PieceBuilder &out) {
+  const std::string lowered = ascii_lower(html);
+  const size_t n = html.size();
+  size_t i = 0;
+
+  while (i < n) {
+    if (html[i] != '<') {
+      size_t next = html.find('<', i);
+      if (next == std::string::npos) {
+        next = n;
+      }
+      out.Text(html.substr(i, next - i));
+      i = next;
+      continue;
+    }
+
+    if (html.compare(i, 4, "<!--") == 0) {
+      size_t end = html.find("-->", i + 4);
+      end = end == std::string::npos ? n : end + 3;
+      out.Markup(html.substr(i, end - i));
+      i = end;
+      continue;
+    }
+
+    size_t end = tag_end(html, i);
+    const char first = i + 1 < n ? html[i + 1] : '\0';
+    if (end == std::string::npos ||
+        !(is_alpha(first) || first == '/' || first == '!' || first == '?')) {
+      out.Text('<'); // A literal '<' in text
+      i++;
+      continue;
+    }
+
+    size_t name_end = i + 1;
+    while (name_end < n && is_alnum(html[name_end])) {
+      name_end++;
+    }
+    const std::string name = lowered.substr(i + 1, name_end - i - 1);
+    const bool self_closing = html[end - 2] == '/';
+    if (!self_closing && std::find(std::begin(kRawElements),
+                                   std::end(kRawElements),
+                                   name) != std::end(kRawElements)) {
+      // Keep everything up to and including the matching close tag
+      const size_t close = lowered.find("</" + name, end);
+      const size_t close_end =
+          close == std::string::npos ? std::string::npos : tag_end(html, close);
+      end = close_end == std::string::npos ? n : close_end;
+    }
+    out.Markup(html.substr(i, end - i));
+    i = end;
+  }
+}
+
+// ------------------------------------------------------------ Markdown ---
+
+// Index of the bracket closing the one at pos, npos if unbalanced
+size_t matching_bracket(const std::string &text, size_t pos, char open,
+                        char close) {
+  int depth = 0;
+  for (size_t i = pos; i < text.size(); i++) {
+    if (text[i] == '\\') {
+      i++;
+    } else if (text[i] == open) {
+      depth++;
+    } else if (text[i] == close && --depth == 0) {
+      return i;
+    }
+  }
+  return std::string::npos;
+}
+
+void split_markdown_inline(const std::string &text, PieceBuilder &out) {
+  const size_t n = text.size();
+  size_t i = 0;
+
+  while (i < n) {
+    const char c = text[i];
+
+    // Backslash escapes stay exactly as written
+    if (c == '\\' && i + 1 < n &&
+        std::ispunct(static_cast<unsigned char>(text[i + 1]))) {
+      out.Markup(text.substr(i, 2));
+      i += 2;
+      continue;
+    }
+
+    // Code span: closed by a backtick run of the same length
+    if (c == '`') {
+      size_t run = 1;
+      while (i + run < n && text[i + run] == '`') {
+        run++;
+      }
+      const size_t close = text.find(std::string(run, '`'), i + run);
+      const size_t end = close == std::string::npos ? i + run : close + run;
+      out.Markup(text.substr(i, end - i));
+      i = end;
+      continue;
+    }
+
+    // [label](url), ![alt](url) and [label][ref]: only the label is prose
+    if (c == '[' || (c == '!' && i + 1 < n && text[i + 1] == '[')) {
+      const size_t open = c == '!' ? i + 1 : i;
+      const size_t label_end = matching_bracket(text, open, '[', ']');
+      if (label_end != std::string::npos && label_end + 1 < n &&
+          (text[label_end + 1] == '(' || text[label_end + 1] == '[')) {
+        const char target_open = text[label_end + 1];
+        const size_t target_end =
+            matching_bracket(text, label_end + 1, target_open,
+                             target_open == '(' ? ')' : ']');
+        if (target_end != std::string::npos) {
+          out.Markup(text.substr(i, open + 1 - i));
+          split_markdown_inline(text.substr(open + 1, label_end - open - 1),
+                                out);
+          out.Markup(text.substr(label_end, target_end + 1 - label_end));
+          i = target_end + 1;
+          continue;
+        }
+      }
+    }
+
+    // Autolinks and inline HTML tags
+    if (c == '<' && i + 1 < n &&
+        (is_alpha(text[i + 1]) || text[i + 1] == '/')) {
+      const size_t end = tag_end(text, i);
+      if (end != std::string::npos) {
+        out.Markup(text.substr(i, end - i));
+        i = end;
+        continue;
+      }
+    }
+
+    // Bare URLs, minus punctuation that ends the sentence around them
+    if ((c == 'h' && (text.compare(i, 7, "http://") == 0 ||
+                      text.compare(i, 8, "https://") == 0)) &&
+        (i == 0 || std::isspace(static_cast<unsigned char>(text[i - 1])) ||
+         text[i - 1] == '(')) {
+      size_t end = i;
+      while (end < n && !std::isspace(static_cast<unsigned char>(text[end]))) {
+        end++;
+      }
+      while (end > i && std::string(".,;:!?)").find(text[end - 1]) !=
+                            std::string::npos) {
+        end--;
+      }
+      out.Markup(text.substr(i, end - i));
+      i = end;
+      continue;
+    }
+
+    // Emphasis and strikethrough markers; '_' inside a word is a character
+    if (c == '*' || c == '_' || c == '~') {
+      size_t run = 1;
+      while (i + run < n && text[i + run] == c) {
+        run++;
+      }
+      const bool intraword = c == '_' && i > 0 && is_alnum(text[i - 1]) &&
+                             i + run < n && is_alnum(text[i + run]);
+      if (!intraword && (c != '~' || run >= 2)) {
+        out.Markup(text.substr(i, run));
+        i += run;
+        continue;
+      }
+      out.Text(text.substr(i, run));
+      i += run;
+      continue;
+    }
+
+    out.Text(c);
+    i++;
+  }
+}
+
+// "---", "***", "___" and longer, optionally spaced
+bool is_thematic_break(const std::string &body) {
+  const char marker = body[0];
+  if (marker != '-' && marker != '*' && marker != '_') {
+    return false;
+  }
+  size_t count = 0;
+  for (char c : body) {
+    if (c == marker) {
+      count++;
+    } else if (c != ' ' && c != '\t') {
+      return false;
+    }
+  }
+  return count >= 3;
+}
+
+// Length of the block prefix of a line: blockquote markers, then a heading,
+// list or task marker
+size_t block_prefix_length(const std::string &body) {
+  const size_t n = body.size();
+  size_t p = 0;
+  while (p < n && body[p] == '>') {
+    p++;
+    while (p < n && body[p] == ' ') {
+      p++;
+    }
+  }
+
+  size_t hashes = 0;
+  while (p + hashes < n && body[p + hashes] == '#' && hashes < 6) {
+    hashes++;
+  }
+  if (hashes > 0 && (p + hashes == n || body[p + hashes] == ' ')) {
+    return std::min(n, p + hashes + 1);
+  }
+
+  if (p + 1 < n && (body[p] == '-' || body[p] == '*' || body[p] == '+') &&
+      body[p + 1] == ' ') {
+    p += 2;
+  } else {
+    size_t digits = 0;
+    while (p + digits < n && is_digit(body[p + digits]) && digits < 9) {
+      digits++;
+    }
+    if (digits > 0 && p + digits + 1 < n &&
+        (body[p + digits] == '.' || body[p + digits] == ')') &&
+        body[p + digits + 1] == ' ') {
+      p += digits + 2;
+    }
+  }
+
+  if (body.compare(p, 4, "[ ] ") == 0 || body.compare(p, 4, "[x] ") == 0 ||
+      body.compare(p, 4, "[X] ") == 0) {
+    p += 4;
+  }
+  return p;
+}
+
+// Table row: cells between unescaped pipes
+void split_table_row(const std::string &row, PieceBuilder &out) {
+  size_t start = 0;
+  for (size_t i = 0; i <= row.size(); i++) {
+    if (i < row.size() && row[i] == '\\') {
+      i++;
+    } else if (i == row.size() || row[i] == '|') {
+      split_markdown_inline(row.substr(start, i - start), out);
+      if (i < row.size()) {
+        out.Markup("|");
+      }
+      start = i + 1;
+    }
+  }
+}
+
+void split_markdown(const std::string &text, PieceBuilder &out) {
+  bool in_fence = false;
+  std::string fence;
+  bool after_blank = true;
+  bool in_indented_code = false;
+
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t line_end = text.find('\n', pos);
+    const bool has_newline = line_end != std::string::npos;
+    if (!has_newline) {
+      line_end = text.size();
+    }
+    const std::string line = text.substr(pos, line_end - pos);
+    pos = has_newline ? line_end + 1 : line_end;
+
+    const size_t indent = line.find_first_not_of(" \t\r");
+    const std::string body =
+        indent == std::string::npos ? "" : line.substr(indent);
+
+    if (in_fence) {
+      out.Markup(line);
+      if (body.compare(0, fence.size(), fence) == 0) {
+        in_fence = false;
+      }
+    } else if (body.empty()) {
+      out.Markup(line);
+    } else if (body.compare(0, 3, "```") == 0 ||
+               body.compare(0, 3, "~~~") == 0) {
+      fence = body.substr(0, 3);
+      in_fence = true;
+      out.Markup(line);
+    } else if ((after_blank || in_indented_code) &&
+               (indent >= 4 || line[0] == '\t')) {
+      in_indented_code = true;
+      out.Markup(line);
+    } else if (is_thematic_break(body)) {
+      out.Markup(line);
+    } else if (body[0] == '<') {
+      split_html(line, out);
+    } else {
+      const size_t prefix = block_prefix_length(body);
+      out.Markup(line.substr(0, indent + prefix));
+      const std::string rest = body.substr(prefix);
+      if (!rest.empty() && rest[0] == '|') {
+        split_table_row(rest, out);
+      } else {
+        split_markdown_inline(rest, out);
+      }
+    }
+
+    if (!body.empty() && indent < 4 && line[0] != '\t') {
+      in_indented_code = false;
+    }
+    after_blank = body.empty();
+    if (has_newline) {
+      out.Markup("\n");
+    }
+  }
+}
+
+} // namespace
+
+bool ParseMarkupFormat(const std::string &name, MarkupFormat &format) {
+  const std::string lowered = ascii_lower(name);
+  if (lowered == "plain" || lowered == "text") {
+    format = MarkupFormat::Plain;
+  } else if (lowered == "markdown" || lowered == "md") {
+    format = MarkupFormat::Markdown;
+  } else if (lowered == "html" || lowered == "htm") {
+    format = MarkupFormat::Html;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::vector<MarkupPiece> SplitMarkup(const std::string &text,
+                                     MarkupFormat format) {
+  PieceBuilder out;
+  switch (format) {
+  case MarkupFormat::Plain:
+    out.Text(text);
+    break;
+  case MarkupFormat::Markdown:
+    split_markdown(text, out);
+    break;
+  case MarkupFormat::Html:
+    split_html(text, out);
+    break;
+  }
+  return out.Finish();
+}
+
+std::string TranslateMarkup(const std::string &text, MarkupFormat format,
+                            TranslationChain &chain,
+                            CancellationTokenPtr cancel) {
+  std::vector<MarkupPiece> pieces = SplitMarkup(text, format);
+  const bool html = format == MarkupFormat::Html;
+
+  // The trimmed core of each text run worth translating
+  struct Run {
+    size_t piece;
+    size_t begin;
+    size_t end;
+  };
+  std::vector<Run> runs;
+  std::vector<std::string> sources;
+  size_t source_bytes = 0;
+  for (size_t i = 0; i < pieces.size(); i++) {
+    const std::string &piece = pieces[i].text;
+    if (!pieces[i].translate) {
+      continue;
+    }
+    const size_t begin = piece.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+      continue;
+    }
+    const size_t end = piece.find_last_not_of(" \t\r\n") + 1;
+    std::string source = piece.substr(begin, end - begin);
+    if (html) {
+      source = decode_html_entities(source);
+    }
+    if (!has_letter(source)) {
+      continue;
+    }
+    runs.push_back(Run{i, begin, end});
+    sources.push_back(normalize_segment(source));
+    source_bytes += sources.back().size();
+  }
+
+  std::cerr << "[DEBUG] Markup: " << runs.size() << " text runs, "
+            << source_bytes << " of " << text.size()
+            << " bytes sent to the model" << std::endl;
+
+  std::vector<std::string> translations;
+  if (!sources.empty()) {
+    translations = chain.TranslateBatch(sources, cancel);
+  }
+  translations.resize(sources.size());
+
+  for (size_t r = runs.size(); r-- > 0;) {
+    const Run &run = runs[r];
+    if (translations[r].empty()) {
+      continue; // Keep the original text
+    }
+    const std::string translation =
+        html ? escape_html(translations[r]) : translations[r];
+    pieces[run.piece].text.replace(run.begin, run.end - run.begin,
+                                   translation);
+  }
+
+  std::string result;
+  result.reserve(text.size());
+  for (const auto &piece : pieces) {
+    result += piece.text;
+  }
+  return result;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "translation_chain.h"
+#include <string>
+#include <vector>
+
+enum class MarkupFormat { Plain, Markdown, Html };
+
+// "plain", "markdown"/"md" or "html". Returns false for anything else.
+bool ParseMarkupFormat(const std::string &name, MarkupFormat &format);
+
+// A run of the input: markup kept verbatim, or text to translate
+struct MarkupPiece {
+  std::string text;
+  bool translate = false;
+};
+
+// Split input into markup and text runs. Tags, comments, code (HTML
+// <script>/<style>/<pre>/<code>, Markdown fences and code spans), URLs and
+// Markdown block/emphasis markers are markup. Inline markup ends a text run,
+// so "a <b>bold</b> word" is translated as three runs: the markup survives
+// exactly, at some cost in fluency around it.
+std::vector<MarkupPiece> SplitMarkup(const std::string &text,
+                                     MarkupFormat format);
+
+// Translate only the text runs, in one batch through the chain, and put the
+// translations back between the original markup. Runs without letters and
+// the whitespace around each run are kept as they are. In HTML, entities are
+// decoded before translation and &, <, > escaped after. Runs the chain could
+// not translate (cancelled) keep their original text.
+std::string TranslateMarkup(const std::string &text, MarkupFormat format,
+                            TranslationChain &chain,
+                            CancellationTokenPtr cancel = nullptr);
@@ -0,0 +1,112 @@
+#include "mock_translator.h"
+#include "utils.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+std::atomic<int64_t> MockTranslator::simulatedMicros{0};
+
+MockTranslator::MockTranslator(const MockTranslatorOptions &options)
+    : options(options) {}
+
+void MockTranslator::set_workload(const Workload &) {}
+
+void MockTranslator::set_max_chunk_tokens(size_t) {}
+
+bool MockTranslator::load_model(const std::string &model_path,
+                                const std::string &tokenizer_path) {
+  // Same path, same shift: runs are reproducible
+  unsigned int sum = 0;
+  for (unsigned char c : model_path) {
+    sum = sum * 31 + c;
+  }
+  shift = 1 + static_cast<int>(sum % 25);
+
+  // Packages that share a tokenizer file exchange tokens, as with real models
+  tokenizerHash = hash_file_contents(tokenizer_path);
+
+  Simulate(options.load_latency);
+  return true;
+}
+
+std::vector<std::string> MockTranslator::encode(const std::string &text) {
+  std::vector<std::string> tokens;
+  std::stringstream ss(text);
+  std::string word;
+  while (ss >> word) {
+    tokens.push_back(word);
+  }
+  return tokens;
+}
+
+std::string MockTranslator::decode(const std::vector<std::string> &tokens) {
+  std::string text;
+  for (const auto &token : tokens) {
+    if (!text.empty()) {
+      text += ' ';
+    }
+    text += token;
+  }
+  return text;
+}
+
+std::vector<std::vector<std::string>> MockTranslator::translate_tokens(
+    const std::vector<std::vector<std::string>> &batch,
+    const std::vector<const CancellationToken *> &cancel) {
+  std::vector<std::vector<std::string>> outputs(batch.size());
+  size_t steps = 0;
+  for (const auto &tokens : batch) {
+    steps = std::max(steps, tokens.size());
+  }
+
+  const auto step_cost =
+      options.step_latency + options.segment_latency * batch.size();
+  for (size_t step = 0; step < steps; step++) {
+    bool active = false;
+    for (size_t i = 0; i < batch.size(); i++) {
+      if (step >= batch[i].size() ||
+          (i < cancel.size() && cancel[i] && cancel[i]->IsCancelled())) {
+        continue;
+      }
+      std::string token = batch[i][step];
+      for (char &c : token) {
+        if (c >= 'a' && c <= 'z') {
+          c = static_cast<char>('a' + (c - 'a' + shift) % 26);
+        } else if (c >= 'A' && c <= 'Z') {
+          c = static_cast<char>('A' + (c - 'A' + shift) % 26);
+        }
+      }
+      outputs[i].push_back(std::move(token));
+      active = true;
+    }
+    if (!active) {
+      break; // Every remaining input was cancelled
+    }
+    Simulate(step_cost);
+  }
+  return outputs;
+}
+
+const std::string &MockTranslator::tokenizer_hash() const {
+  return tokenizerHash;
+}
+
+void MockTranslator::Simulate(std::chrono::microseconds duration) {
+  if (duration.count() <= 0) {
+    return;
+  }
+  // Count the time actually slept so oversleeping is not charged to the
+  // orchestration layer
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(duration);
+  simulatedMicros += std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+}
+
+std::chrono::microseconds MockTranslator::GetSimulatedTime() {
+  return std::chrono::microseconds(simulatedMicros.load());
+}
+
+void MockTranslator::ResetSimulatedTime() { simulatedMicros = 0; }
@@ -0,0 +1,56 @@
+#pragma once
+#include "translation_model.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Synthetic costs of a MockTranslator. Decoding one batch takes
+//   steps * (step_latency + segment_latency * segments)
+// where steps is the longest input, mirroring greedy decoding that emits one
+// token per input per step.
+struct MockTranslatorOptions {
+  std::chrono::milliseconds load_latency{0};
+  std::chrono::microseconds step_latency{0};
+  std::chrono::microseconds segment_latency{0};
+};
+
+// Stand-in for ArgosTranslator that needs no model files. Tokens are
+// whitespace-separated words and every model "translates" by shifting ASCII
+// letters by an amount derived from its model path, so outputs are
+// deterministic and each hop of a chain visibly changes the text.
+class MockTranslator : public TranslationModel {
+public:
+  explicit MockTranslator(
+      const MockTranslatorOptions &options = MockTranslatorOptions());
+
+  void set_workload(const Workload &workload) override;
+  void set_max_chunk_tokens(size_t max_tokens) override;
+
+  bool load_model(const std::string &model_path,
+                  const std::string &tokenizer_path) override;
+
+  std::vector<std::string> encode(const std::string &text) override;
+  std::string decode(const std::vector<std::string> &tokens) override;
+
+  std::vector<std::vector<std::string>>
+  translate_tokens(const std::vector<std::vector<std::string>> &batch,
+                   const std::vector<const CancellationToken *> &cancel =
+                       {}) override;
+
+  const std::string &tokenizer_hash() const override;
+
+  // Total synthetic latency spent by every MockTranslator in the process;
+  // wall time minus this is the cost of the orchestration around the models
+  static std::chrono::microseconds GetSimulatedTime();
+  static void ResetSimulatedTime();
+
+private:
+  void Simulate(std::chrono::microseconds duration);
+
+  MockTranslatorOptions options;
+  int shift = 1;
+  std::string tokenizerHash;
+
+  static std::atomic<int64_t> simulatedMicros;
+};
@@ -0,0 +1,117 @@
+#include "model_cache.h"
+#include "package_stats.h"
+#include "translation.h"
+#include <chrono>
+#include <iostream>
+
+ModelCache &ModelCache::GetInstance() {
+  static ModelCache instance;
+  return instance;
+}
+
+std::shared_ptr<BatchScheduler>
+ModelCache::Acquire(const PackageFiles &package) {
+  // The first caller loads the package without holding cacheMutex, so a
+  // cold load never stalls callers of models that are already resident.
+  // Callers asking for the same package meanwhile wait for that load.
+  std::promise<std::shared_ptr<BatchScheduler>> promise;
+  std::shared_future<std::shared_ptr<BatchScheduler>> pending_load;
+  std::shared_ptr<TranslationModel> translator;
+  BatchSchedulerOptions options;
+  size_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = schedulers.find(package.name);
+    if (it != schedulers.end()) {
+      return it->second;
+    }
+    auto pending = loading.find(package.name);
+    if (pending != loading.end()) {
+      pending_load = pending->second;
+    } else {
+      loading[package.name] = promise.get_future().share();
+      translator =
+          modelFactory ? modelFactory() : std::make_shared<ArgosTranslator>();
+      if (maxChunkTokens > 0) {
+        translator->set_max_chunk_tokens(maxChunkTokens);
+      }
+      translator->set_workload(workload);
+      options = schedulerOptions;
+      generation = clearCount;
+    }
+  }
+  if (pending_load.valid()) {
+    return pending_load.get();
+  }
+
+  std::shared_ptr<BatchScheduler> scheduler;
+  try {
+    auto start = std::chrono::steady_clock::now();
+    if (translator->load_model(package.model_dir, package.tokenizer_model)) {
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      PackageStats::GetInstance().RecordLoad(package.name, elapsed.count());
+      scheduler = std::make_shared<BatchScheduler>(std::move(translator),
+                                                   package.name, options);
+    }
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(cacheMutex);
+      loading.erase(package.name);
+    }
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+
+  {
+    // A failed load is not cached, so the next Acquire tries again. A model
+    // loaded across a Clear() is handed out but not kept.
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (scheduler && generation == clearCount) {
+      schedulers[package.name] = scheduler;
+    }
+    loading.erase(package.name);
+  }
+  promise.set_value(scheduler);
+  return scheduler;
+}
+
+std::set<std::string> ModelCache::GetLoadedPackages() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  std::set<std::string> names;
+  for (const auto &entry : schedulers) {
+    names.insert(entry.first);
+  }
+  return names;
+}
+
+bool ModelCache::IsLoaded(const std::string &package_name) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return schedulers.count(package_name) > 0;
+}
+
+void ModelCache::SetSchedulerOptions(const BatchSchedulerOptions &options) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  schedulerOptions = options;
+}
+
+void ModelCache::SetMaxChunkTokens(size_t max_tokens) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  maxChunkTokens = max_tokens;
+}
+
+void ModelCache::SetWorkload(const Workload &new_workload) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  workload = new_workload;
+}
+
+void ModelCache::SetModelFactory(ModelFactory factory) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  modelFactory = std::move(factory);
+}
+
+void ModelCache::Clear() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  schedulers.clear();
+  clearCount++;
+}
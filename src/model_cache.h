@@ -0,0 +1,60 @@
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#include "batch_scheduler.h"
+#include "translation_chain.h"
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+// Process-wide registry of loaded models. Each package is loaded once and
+// fronted by a BatchScheduler, so concurrent callers translating with the
+// same package share one model and have their requests batched together.
+class ModelCache {
+public:
+  using ModelFactory = std::function<std::shared_ptr<TranslationModel>()>;
+
+  static ModelCache &GetInstance();
+
+  // Load the package on first use. Returns nullptr if loading fails. Only
+  // callers of the package being loaded wait for the load.
+  std::shared_ptr<BatchScheduler> Acquire(const PackageFiles &package);
+
+  // Whether the package is already resident in this process
+  bool IsLoaded(const std::string &package_name);
+  std::set<std::string> GetLoadedPackages();
+
+  // Applies to models loaded after the call
+  void SetSchedulerOptions(const BatchSchedulerOptions &options);
+  void SetMaxChunkTokens(size_t max_tokens);
+  void SetWorkload(const Workload &workload);
+
+  // Backend for models loaded after the call, e.g. a MockTranslator for
+  // benchmarks. The default creates an ArgosTranslator.
+  void SetModelFactory(ModelFactory factory);
+
+  // Drop every cached model (they are freed once no caller holds them)
+  void Clear();
+
+private:
+  ModelCache() = default;
+  ModelCache(const ModelCache &) = delete;
+  ModelCache &operator=(const ModelCache &) = delete;
+
+  std::map<std::string, std::shared_ptr<BatchScheduler>> schedulers;
+  // Loads in progress, shared with the callers waiting for them
+  std::map<std::string, std::shared_future<std::shared_ptr<BatchScheduler>>>
+      loading;
+  size_t clearCount = 0; // Loads started before a Clear() are not cached
+  BatchSchedulerOptions schedulerOptions;
+  size_t maxChunkTokens = 0; // 0 keeps chunking off
+  Workload workload;
+  ModelFactory modelFactory;
+  std::mutex cacheMutex;
+};
+
+#endif
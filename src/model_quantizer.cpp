@@ -0,0 +1,310 @@
+#include "model_quantizer.h"
+#include "utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+// CTranslate2 model.bin layout (binary version 4 and later, host byte order):
+//   uint32 version, string spec, uint32 spec_revision, uint32 num_variables
+//   per variable: string name, uint8 rank, uint32 dims[rank], uint8 dtype,
+//                 uint32 num_bytes, data
+//   uint32 num_aliases, per alias: string alias, string variable
+// Strings are a uint16 length (including the terminating NUL) and the bytes.
+
+namespace {
+
+const uint32_t kMinVersion = 4;
+const uint32_t kMaxVersion = 6;
+
+// ctranslate2::DataType ids
+enum DType : uint8_t { kFloat32 = 0, kInt8 = 1, kFloat16 = 4 };
+
+class Reader {
+public:
+  explicit Reader(std::istream &in) : in(in) {}
+
+  template <typename T> T Read() {
+    T value;
+    ReadBytes(reinterpret_cast<char *>(&value), sizeof(value));
+    return value;
+  }
+
+  void ReadBytes(char *data, size_t size) {
+    if (!in.read(data, static_cast<std::streamsize>(size))) {
+      throw std::runtime_error("model.bin is truncated");
+    }
+  }
+
+  std::string ReadString() {
+    const uint16_t length = Read<uint16_t>();
+    std::string text(length, '\0');
+    ReadBytes(text.data(), length);
+    // Stored with its NUL terminator
+    if (!text.empty() && text.back() == '\0') {
+      text.pop_back();
+    }
+    return text;
+  }
+
+private:
+  std::istream &in;
+};
+
+class Writer {
+public:
+  explicit Writer(std::ostream &out) : out(out) {}
+
+  template <typename T> void Write(T value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  void WriteBytes(const char *data, size_t size) {
+    out.write(data, static_cast<std::streamsize>(size));
+  }
+
+  void WriteString(const std::string &text) {
+    Write<uint16_t>(static_cast<uint16_t>(text.size() + 1));
+    out.write(text.c_str(), static_cast<std::streamsize>(text.size() + 1));
+  }
+
+private:
+  std::ostream &out;
+};
+
+float half_to_float(uint16_t half) {
+  const uint32_t sign = (half & 0x8000u) << 16;
+  uint32_t exponent = (half >> 10) & 0x1Fu;
+  uint32_t mantissa = half & 0x3FFu;
+  uint32_t bits;
+  if (exponent == 0x1F) {
+    bits = sign | 0x7F800000u | (mantissa << 13); // Inf/NaN
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  } else if (mantissa == 0) {
+    bits = sign; // Zero
+  } else {
+    // Subnormal: normalize the mantissa
+    exponent = 113;
+    while ((mantissa & 0x400u) == 0) {
+      mantissa <<= 1;
+      exponent--;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+  }
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Linear and embedding matrices; biases, layer norms and position
+// encodings stay in float like CTranslate2's converter leaves them
+bool is_quantizable(const std::string &name, const std::vector<uint32_t> &dims,
+                    uint8_t dtype) {
+  const std::string suffix = "weight";
+  return dims.size() == 2 && (dtype == kFloat32 || dtype == kFloat16) &&
+         name.size() >= suffix.size() &&
+         name.compare(name.size() - suffix.size(), suffix.size(), suffix) ==
+             0 &&
+         (name.size() == suffix.size() ||
+          name[name.size() - suffix.size() - 1] == '/');
+}
+
+// Symmetric per-row quantization: scale = 127 / max|row|
+void quantize_rows(const std::vector<char> &data, uint8_t dtype, size_t rows,
+                   size_t cols, std::vector<int8_t> &quantized,
+                   std::vector<float> &scales) {
+  quantized.resize(rows * cols);
+  scales.resize(rows);
+  std::vector<float> row(cols);
+  for (size_t r = 0; r < rows; r++) {
+    for (size_t c = 0; c < cols; c++) {
+      const size_t i = r * cols + c;
+      if (dtype == kFloat32) {
+        std::memcpy(&row[c], data.data() + i * 4, 4);
+      } else {
+        uint16_t half;
+        std::memcpy(&half, data.data() + i * 2, 2);
+        row[c] = half_to_float(half);
+      }
+    }
+
+    float amax = 0;
+    for (float value : row) {
+      amax = std::max(amax, std::fabs(value));
+    }
+    const float scale = amax > 0 ? 127.0f / amax : 1.0f;
+    scales[r] = scale;
+    for (size_t c = 0; c < cols; c++) {
+      const float value = std::nearbyint(row[c] * scale);
+      quantized[r * cols + c] =
+          static_cast<int8_t>(std::clamp(value, -127.0f, 127.0f));
+    }
+  }
+}
+
+// Copy model.bin to out, quantizing weights on the way. Returns the number
+// of quantized variables (0 means the output would be identical).
+size_t rewrite_model(std::istream &in, std::fstream &out) {
+  Reader reader(in);
+  Writer writer(out);
+
+  const uint32_t version = reader.Read<uint32_t>();
+  if (version < kMinVersion || version > kMaxVersion) {
+    throw std::runtime_error("unsupported model.bin version " +
+                             std::to_string(version));
+  }
+  writer.Write(version);
+  writer.WriteString(reader.ReadString()); // Spec name
+  writer.Write(reader.Read<uint32_t>());   // Spec revision
+
+  const uint32_t num_variables = reader.Read<uint32_t>();
+  const auto count_position = out.tellp();
+  writer.Write(num_variables); // Patched once scales are added
+
+  std::set<std::string> quantized_names;
+  std::vector<char> data;
+  std::vector<int8_t> quantized;
+  std::vector<float> scales;
+  uint32_t written = 0;
+  for (uint32_t v = 0; v < num_variables; v++) {
+    const std::string name = reader.ReadString();
+    const uint8_t rank = reader.Read<uint8_t>();
+    std::vector<uint32_t> dims(rank);
+    for (auto &dim : dims) {
+      dim = reader.Read<uint32_t>();
+    }
+    const uint8_t dtype = reader.Read<uint8_t>();
+    const uint32_t num_bytes = reader.Read<uint32_t>();
+    data.resize(num_bytes);
+    reader.ReadBytes(data.data(), num_bytes);
+
+    writer.WriteString(name);
+    writer.Write(rank);
+    for (uint32_t dim : dims) {
+      writer.Write(dim);
+    }
+
+    const size_t item_size = dtype == kFloat32 ? 4 : 2;
+    if (!is_quantizable(name, dims, dtype) ||
+        size_t(dims[0]) * dims[1] * item_size != num_bytes) {
+      writer.Write(dtype);
+      writer.Write(num_bytes);
+      writer.WriteBytes(data.data(), data.size());
+      written++;
+      continue;
+    }
+
+    quantize_rows(data, dtype, dims[0], dims[1], quantized, scales);
+    writer.Write<uint8_t>(kInt8);
+    writer.Write(static_cast<uint32_t>(quantized.size()));
+    writer.WriteBytes(reinterpret_cast<const char *>(quantized.data()),
+                      quantized.size());
+
+    writer.WriteString(name + "_scale");
+    writer.Write<uint8_t>(1);
+    writer.Write(dims[0]);
+    writer.Write<uint8_t>(kFloat32);
+    writer.Write(static_cast<uint32_t>(scales.size() * sizeof(float)));
+    writer.WriteBytes(reinterpret_cast<const char *>(scales.data()),
+                      scales.size() * sizeof(float));
+    written += 2;
+    quantized_names.insert(name);
+  }
+
+  if (quantized_names.empty()) {
+    return 0;
+  }
+
+  // Shared weights (e.g. tied embeddings) are aliases; they need their scale
+  // aliased as well
+  std::vector<std::pair<std::string, std::string>> aliases;
+  const uint32_t num_aliases = reader.Read<uint32_t>();
+  for (uint32_t a = 0; a < num_aliases; a++) {
+    std::string alias = reader.ReadString();
+    std::string variable = reader.ReadString();
+    if (quantized_names.count(variable)) {
+      aliases.emplace_back(alias + "_scale", variable + "_scale");
+    }
+    aliases.emplace_back(std::move(alias), std::move(variable));
+  }
+  writer.Write(static_cast<uint32_t>(aliases.size()));
+  for (const auto &[alias, variable] : aliases) {
+    writer.WriteString(alias);
+    writer.WriteString(variable);
+  }
+
+  // Anything newer versions append after the aliases is kept as-is
+  if (in.peek() != std::char_traits<char>::eof()) {
+    out << in.rdbuf();
+  }
+
+  out.seekp(count_position);
+  writer.Write(written);
+  return quantized_names.size();
+}
+
+} // namespace
+
+bool QuantizeModelToInt8(const std::string &model_dir, QuantizeStats *stats) {
+  const std::filesystem::path model_path =
+      std::filesystem::path(model_dir) / "model.bin";
+  // Our own temp file, so concurrent installs of a package never interleave
+  const std::filesystem::path tmp_path =
+      unique_temp_path(model_path.string() + ".int8");
+
+  size_t quantized = 0;
+  try {
+    std::ifstream in(model_path, std::ios::binary);
+    if (!in.is_open()) {
+      std::cerr << "Failed to open " << model_path << std::endl;
+      return false;
+    }
+    std::fstream out(tmp_path, std::ios::binary | std::ios::in |
+                                   std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+      std::cerr << "Failed to create " << tmp_path << std::endl;
+      return false;
+    }
+    quantized = rewrite_model(in, out);
+    out.flush();
+    if (!out) {
+      throw std::runtime_error("write failed (disk full?)");
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Failed to quantize " << model_path << ": " << e.what()
+              << std::endl;
+    std::error_code ec;
+    std::filesystem::remove(tmp_path, ec);
+    return false;
+  }
+
+  std::error_code ec;
+  const size_t bytes_before = std::filesystem::file_size(model_path, ec);
+  size_t bytes_after = bytes_before;
+  if (quantized == 0) {
+    std::filesystem::remove(tmp_path, ec); // Nothing to convert
+  } else {
+    bytes_after = std::filesystem::file_size(tmp_path, ec);
+    std::filesystem::rename(tmp_path, model_path, ec);
+    if (ec) {
+      std::cerr << "Failed to replace " << model_path << ": " << ec.message()
+                << std::endl;
+      std::filesystem::remove(tmp_path, ec);
+      return false;
+    }
+  }
+
+  if (stats) {
+    stats->bytes_before = bytes_before;
+    stats->bytes_after = bytes_after;
+    stats->quantized_variables = quantized;
+  }
+  return true;
+}
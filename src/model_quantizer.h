@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+struct QuantizeStats {
+  size_t bytes_before = 0;
+  size_t bytes_after = 0;
+  size_t quantized_variables = 0;
+};
+
+// Rewrite <model_dir>/model.bin so float weight matrices are stored as int8
+// with one float32 scale per row (<name>_scale), the layout CTranslate2's
+// converter writes for --quantization int8. Loading then reads about a
+// quarter of the bytes and runs int8 kernels without converting at startup.
+// Already-quantized models are left untouched. The file is replaced
+// atomically; on error the original is kept and false is returned.
+bool QuantizeModelToInt8(const std::string &model_dir,
+                         QuantizeStats *stats = nullptr);
@@ -0,0 +1,271 @@
+#include "moses_tokenizer.h"
+#include <algorithm>
+#include <array>
+
+namespace {
+
+enum class CharClass : uint8_t {
+  Space,
+  Letter,
+  Digit,
+  Joiner, // ' ` - part of the word around them
+  Comma,
+  Period,
+  Punct, // Always a token of its own
+};
+
+struct Range {
+  char32_t first;
+  char32_t last;
+};
+
+// Unicode punctuation and symbols outside ASCII, sorted. Letters and digits
+// of every script fall outside these ranges.
+const Range kPunctRanges[] = {
+    {0x00A1, 0x00A9}, {0x00AB, 0x00B4}, {0x00B6, 0x00B9}, {0x00BB, 0x00BF},
+    {0x00D7, 0x00D7}, {0x00F7, 0x00F7}, {0x037E, 0x037E}, {0x0387, 0x0387},
+    {0x055A, 0x055F}, {0x0589, 0x058A}, {0x05BE, 0x05BE}, {0x05C0, 0x05C0},
+    {0x05C3, 0x05C3}, {0x05F3, 0x05F4}, {0x060C, 0x060D}, {0x061B, 0x061F},
+    {0x066A, 0x066D}, {0x06D4, 0x06D4}, {0x0964, 0x0965}, {0x0970, 0x0970},
+    {0x0E4F, 0x0E4F}, {0x0E5A, 0x0E5B}, {0x10FB, 0x10FB}, {0x1361, 0x1368},
+    {0x2010, 0x2027}, {0x2030, 0x205E}, {0x20A0, 0x20CF}, {0x2190, 0x23FF},
+    {0x2500, 0x27BF}, {0x2E00, 0x2E7F}, {0x3001, 0x3004}, {0x3008, 0x3020},
+    {0x3030, 0x3030}, {0x303D, 0x303F}, {0x30FB, 0x30FB}, {0xFE30, 0xFE6F},
+    {0xFF01, 0xFF0F}, {0xFF1A, 0xFF20}, {0xFF3B, 0xFF40}, {0xFF5B, 0xFF65},
+    {0x1F000, 0x1FAFF},
+};
+
+const Range kSpaceRanges[] = {
+    {0x00A0, 0x00A0}, {0x1680, 0x1680}, {0x2000, 0x200A},
+    {0x2028, 0x2029}, {0x202F, 0x202F}, {0x205F, 0x205F},
+    {0x3000, 0x3000}, {0xFEFF, 0xFEFF},
+};
+
+template <size_t N> bool in_ranges(const Range (&ranges)[N], char32_t c) {
+  const Range *range = std::upper_bound(
+      ranges, ranges + N, c,
+      [](char32_t value, const Range &r) { return value < r.first; });
+  return range != ranges && c <= (range - 1)->last;
+}
+
+const std::array<CharClass, 128> &ascii_classes() {
+  static const std::array<CharClass, 128> classes = [] {
+    std::array<CharClass, 128> table;
+    for (int c = 0; c < 128; c++) {
+      if (c <= ' ' || c == 0x7F) {
+        // Moses drops control characters
+        table[c] = CharClass::Space;
+      } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+        table[c] = CharClass::Letter;
+      } else if (c >= '0' && c <= '9') {
+        table[c] = CharClass::Digit;
+      } else if (c == '\'' || c == '`' || c == '-') {
+        table[c] = CharClass::Joiner;
+      } else if (c == ',') {
+        table[c] = CharClass::Comma;
+      } else if (c == '.') {
+        table[c] = CharClass::Period;
+      } else {
+        table[c] = CharClass::Punct;
+      }
+    }
+    return table;
+  }();
+  return classes;
+}
+
+// Code point of the character at text[offset, offset + length); stray
+// bytes decode to themselves and classify as letters
+char32_t decode_char(std::string_view text, size_t offset, size_t length) {
+  const unsigned char lead = text[offset];
+  if (length == 1) {
+    return lead;
+  }
+  static const unsigned char lead_mask[] = {0, 0, 0x1F, 0x0F, 0x07};
+  char32_t c = lead & lead_mask[std::min<size_t>(length, 4)];
+  for (size_t i = 1; i < length; i++) {
+    c = (c << 6) | (static_cast<unsigned char>(text[offset + i]) & 0x3F);
+  }
+  return c;
+}
+
+CharClass classify(char32_t c) {
+  if (c < 0x80) {
+    return ascii_classes()[c];
+  }
+  if (in_ranges(kSpaceRanges, c)) {
+    return CharClass::Space;
+  }
+  return in_ranges(kPunctRanges, c) ? CharClass::Punct : CharClass::Letter;
+}
+
+bool starts_lowercase(std::string_view text, size_t offset) {
+  const unsigned char c = text[offset];
+  if (c >= 'a' && c <= 'z') {
+    return true;
+  }
+  // Latin-1 lowercase letters (U+00DF-U+00FF except U+00F7)
+  if (c == 0xC3 && offset + 1 < text.size()) {
+    const unsigned char next = text[offset + 1];
+    return next >= 0x9F && next <= 0xBF && next != 0xB7;
+  }
+  return false;
+}
+
+// Titles from the Moses nonbreaking-prefix lists that end no sentence
+bool is_title(std::string_view word) {
+  static const char *const titles[] = {"Mr", "Mrs", "Ms",  "Dr",   "Prof",
+                                       "St", "Jr",  "Sr",  "Sra",  "Srta",
+                                       "Hr", "Fr",  "Mme", "Mlle", "vs"};
+  return std::find(std::begin(titles), std::end(titles), word) !=
+         std::end(titles);
+}
+
+// Token as a range of character indices
+struct Token {
+  size_t first;
+  size_t end;
+};
+
+} // namespace
+
+void MosesPreTokenize(std::string_view text, const std::vector<uint32_t> &chars,
+                      std::vector<std::string_view> &spans) {
+  const size_t count = chars.size();
+  auto char_end = [&](size_t k) -> size_t {
+    return k + 1 < count ? chars[k + 1] : text.size();
+  };
+
+  // Scratch space reused by every call on this thread
+  thread_local std::vector<CharClass> classes;
+  thread_local std::vector<Token> tokens;
+  classes.resize(count);
+  tokens.clear();
+  for (size_t k = 0; k < count; k++) {
+    classes[k] = classify(decode_char(text, chars[k], char_end(k) - chars[k]));
+  }
+
+  size_t start = 0; // First character of the pending token
+  auto flush = [&](size_t end) {
+    if (end > start) {
+      tokens.push_back({start, end});
+    }
+    start = end;
+  };
+  for (size_t k = 0; k < count; k++) {
+    const CharClass c = classes[k];
+    if (c == CharClass::Space) {
+      flush(k);
+      start = k + 1;
+    } else if (c == CharClass::Punct ||
+               (c == CharClass::Comma &&
+                !(k > 0 && classes[k - 1] == CharClass::Digit &&
+                  k + 1 < count && classes[k + 1] == CharClass::Digit))) {
+      flush(k);
+      flush(k + 1);
+    } else if (c == CharClass::Period && k + 1 < count &&
+               classes[k + 1] == CharClass::Period) {
+      size_t run = k + 1;
+      while (run < count && classes[run] == CharClass::Period) {
+        run++;
+      }
+      flush(k);
+      flush(run);
+      k = run - 1;
+    }
+  }
+  flush(count);
+
+  for (size_t t = 0; t < tokens.size(); t++) {
+    const Token token = tokens[t];
+    const size_t last = token.end - 1;
+    const size_t begin = chars[token.first];
+    bool split = token.end - token.first >= 2 &&
+                 classes[last] == CharClass::Period &&
+                 classes[last - 1] != CharClass::Period;
+    if (split) {
+      bool has_period = false;
+      bool has_letter = false;
+      for (size_t k = token.first; k < last; k++) {
+        has_period = has_period || classes[k] == CharClass::Period;
+        has_letter = has_letter || classes[k] == CharClass::Letter;
+      }
+      const unsigned char initial = text[chars[token.first]];
+      const bool abbreviation =
+          (has_period && has_letter) ||
+          is_title(text.substr(begin, chars[last] - begin)) ||
+          (last - token.first == 1 && initial >= 'A' && initial <= 'Z') ||
+          (t + 1 < tokens.size() &&
+           starts_lowercase(text, chars[tokens[t + 1].first]));
+      split = !abbreviation;
+    }
+
+    if (split) {
+      spans.push_back(text.substr(begin, chars[last] - begin));
+      spans.push_back(text.substr(chars[last], char_end(last) - chars[last]));
+    } else {
+      spans.push_back(text.substr(begin, char_end(last) - begin));
+    }
+  }
+}
+
+namespace {
+
+bool is_one_of(std::string_view token, const char *const *set, size_t size) {
+  return std::find(set, set + size, token) != set + size;
+}
+
+bool attaches_left(std::string_view token) {
+  static const char *const closing[] = {
+      ",", ".", "!", "?", ";", ":", "%", ")", "]", "}", "\xC2\xBB",
+      "\xE2\x80\x9D", "\xE2\x80\x99", "\xE2\x80\xA6", "\xE3\x80\x81",
+      "\xE3\x80\x82", "\xE3\x80\x8D", "\xE3\x80\x8F", "\xEF\xBC\x8C",
+      "\xEF\xBC\x81", "\xEF\xBC\x9F", "\xEF\xBC\x9A", "\xEF\xBC\x9B",
+      "\xEF\xBC\x89"};
+  if (!token.empty() &&
+      token.find_first_not_of('.') == std::string_view::npos) {
+    return true;
+  }
+  return is_one_of(token, closing, sizeof(closing) / sizeof(*closing));
+}
+
+bool attaches_right(std::string_view token) {
+  // CJK text has no spaces, so its punctuation glues on both sides
+  static const char *const opening[] = {
+      "(", "[", "{", "$", "\xC2\xBF", "\xC2\xA1", "\xC2\xAB", "\xC2\xA3",
+      "\xE2\x82\xAC", "\xE2\x80\x9C", "\xE2\x80\x98", "\xE2\x80\x9E",
+      "\xE3\x80\x8C", "\xE3\x80\x8E", "\xEF\xBC\x88", "\xE3\x80\x81",
+      "\xE3\x80\x82", "\xEF\xBC\x8C", "\xEF\xBC\x81", "\xEF\xBC\x9F",
+      "\xEF\xBC\x9A", "\xEF\xBC\x9B"};
+  return is_one_of(token, opening, sizeof(opening) / sizeof(*opening));
+}
+
+} // namespace
+
+void MosesDetokenize(std::string_view tokens, std::string &out) {
+  bool glue_next = true; // No space before the first token
+  bool quote_open = false;
+  size_t pos = 0;
+  while (pos < tokens.size()) {
+    const size_t end = std::min(tokens.find(' ', pos), tokens.size());
+    const std::string_view token = tokens.substr(pos, end - pos);
+    pos = end + 1;
+    if (token.empty()) {
+      continue;
+    }
+
+    const bool after_opening = glue_next;
+    bool glue = after_opening || attaches_left(token);
+    glue_next = attaches_right(token);
+    // Straight quotes alternate between opening and closing
+    if (token == "\"" || token == "'") {
+      glue = after_opening || quote_open;
+      glue_next = !quote_open;
+      quote_open = !quote_open;
+    }
+    if (!glue) {
+      out += ' ';
+    }
+    out.append(token.data(), token.size());
+  }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Moses-style tokenization (tokenizer.perl, language-independent rules), as
+// legacy BPE models were trained on:
+//   - every character that is not a letter, digit, ' ` , . or - becomes a
+//     token of its own ("(hi)!" -> "( hi ) !"), using a table of ASCII
+//     classes and of Unicode punctuation and symbol ranges
+//   - commas stay inside numbers ("1,000") and split off elsewhere
+//   - runs of periods are one token ("wait..." -> "wait ...")
+//   - a final period is split off unless it ends an abbreviation: one that
+//     contains another period ("U.S."), a single capital ("J."), a title
+//     ("Mr.") or one followed by a lowercase word ("etc. and")
+//   - apostrophes and hyphens stay inside words; control characters and
+//     Unicode spaces separate tokens
+//
+// chars are the character offsets of text (see SplitUtf8). Spans are views
+// into text, appended to spans.
+void MosesPreTokenize(std::string_view text, const std::vector<uint32_t> &chars,
+                      std::vector<std::string_view> &spans);
+
+// Undo the spacing of Moses tokenization: no space before closing
+// punctuation or after opening brackets, quotes and currency signs
+// ("Hello , \" world \" !" -> "Hello, \"world\"!"). The result is appended
+// to out.
+void MosesDetokenize(std::string_view tokens, std::string &out);
@@ -8,6 +8,26 @@ using json = nlohmann::json;
 
 static const std::string OLLAMA_BASE_URL = "http://localhost:11434";
 
+// System prompt for focused, non-verbose responses
+static const std::string DEFAULT_SYSTEM_PROMPT =
+    "Always answer in the user's language."
+    "Absolute Mode. Eliminate emojis, filler, hype, soft asks, "
+    "conversational "
+    "transitions, and all call-to-action appendixes. Prioritize blunt, "
+    "directive "
+    "phrasing. Disable all behaviors optimizing for engagement, sentiment "
+    "uplift, "
+    "or interaction extension. Suppress emotional softening or continuation "
+    "bias. "
+    "Never mirror the user's diction, mood, or affect. No questions, no "
+    "offers, "
+    "no suggestions, no transitional phrasing. Terminate each reply "
+    "immediately "
+    "after delivering the requested material. No appendixes, no soft "
+    "closures. "
+    "Challenge assumptions with precision, offer unfamiliar perspectives. "
+    "Be ruthless but respectful. Seek truth above comfort.";
+
 // Callback for libcurl to write response data
 static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
                             std::string *userp) {
@@ -87,31 +107,11 @@ std::vector<std::string> get_ollama_models() {
 }
 
 std::string query_ollama(const std::string &model, const std::string &prompt) {
-  // System prompt for focused, non-verbose responses
-  static const std::string SYSTEM_PROMPT =
-      "Always answer in the user's language."
-      "Absolute Mode. Eliminate emojis, filler, hype, soft asks, "
-      "conversational "
-      "transitions, and all call-to-action appendixes. Prioritize blunt, "
-      "directive "
-      "phrasing. Disable all behaviors optimizing for engagement, sentiment "
-      "uplift, "
-      "or interaction extension. Suppress emotional softening or continuation "
-      "bias. "
-      "Never mirror the user's diction, mood, or affect. No questions, no "
-      "offers, "
-      "no suggestions, no transitional phrasing. Terminate each reply "
-      "immediately "
-      "after delivering the requested material. No appendixes, no soft "
-      "closures. "
-      "Challenge assumptions with precision, offer unfamiliar perspectives. "
-      "Be ruthless but respectful. Seek truth above comfort.";
-
   // Build request JSON
   json request;
   request["model"] = model;
   request["prompt"] = prompt;
-  request["system"] = SYSTEM_PROMPT;
+  request["system"] = DEFAULT_SYSTEM_PROMPT;
   request["stream"] = false;
 
   // Options removed to allow default Ollama behavior
@@ -210,3 +210,137 @@ std::string query_ollama_with_role(const std::string &model,
     return "Error: Failed to parse Ollama response - " + std::string(e.what());
   }
 }
+
+OllamaStreamParser::OllamaStreamParser(
+    const std::function<void(const std::string &)> *on_chunk)
+    : on_chunk(on_chunk) {}
+
+// Ollama streams one JSON object per line
+void OllamaStreamParser::Feed(const char *data, size_t size) {
+  pending.append(data, size);
+  size_t line_end;
+  while ((line_end = pending.find('\n')) != std::string::npos) {
+    std::string line = pending.substr(0, line_end);
+    pending.erase(0, line_end + 1);
+    ParseLine(line);
+  }
+}
+
+bool OllamaStreamParser::Finish(long http_status, std::string &error_out) {
+  // Error replies are a single object, usually without a final newline
+  std::string line;
+  line.swap(pending);
+  ParseLine(line);
+  if (http_status >= 400 && error.empty()) {
+    error = "Ollama returned HTTP " + std::to_string(http_status);
+  }
+  if (!error.empty()) {
+    error_out = error;
+    return false;
+  }
+  return true;
+}
+
+void OllamaStreamParser::ParseLine(const std::string &line) {
+  if (line.find_first_not_of(" \t\r") == std::string::npos) {
+    return;
+  }
+  try {
+    json data = json::parse(line);
+    if (data.contains("error")) {
+      error = data["error"].get<std::string>();
+    } else if (data.contains("response")) {
+      std::string chunk = data["response"].get<std::string>();
+      response += chunk;
+      if (!chunk.empty() && on_chunk && *on_chunk) {
+        (*on_chunk)(chunk);
+      }
+    }
+  } catch (const std::exception &e) {
+    error = "Failed to parse Ollama response - " + std::string(e.what());
+  }
+}
+
+namespace {
+
+// State shared with the curl callbacks of a streamed generation
+struct StreamState {
+  OllamaStreamParser *parser = nullptr;
+  const CancellationToken *cancel = nullptr;
+};
+
+size_t StreamWriteCallback(void *contents, size_t size, size_t nmemb,
+                           StreamState *state) {
+  size_t total_size = size * nmemb;
+  state->parser->Feed(static_cast<char *>(contents), total_size);
+  return total_size;
+}
+
+// Aborts the transfer once the token fires
+int StreamProgressCallback(void *clientp, curl_off_t, curl_off_t, curl_off_t,
+                           curl_off_t) {
+  const auto *state = static_cast<StreamState *>(clientp);
+  return state->cancel && state->cancel->IsCancelled() ? 1 : 0;
+}
+
+} // namespace
+
+bool query_ollama_stream(
+    const std::string &model, const std::string &prompt,
+    const std::string &system,
+    const std::function<void(const std::string &)> &on_chunk,
+    const CancellationToken *cancel, std::string &response,
+    std::string &error) {
+  json request;
+  request["model"] = model;
+  request["prompt"] = prompt;
+  request["system"] = system.empty() ? DEFAULT_SYSTEM_PROMPT : system;
+  request["stream"] = true;
+  std::string post_data = request.dump();
+
+  CURL *curl = curl_easy_init();
+  if (!curl) {
+    error = "Failed to initialize curl";
+    return false;
+  }
+
+  OllamaStreamParser parser(&on_chunk);
+  StreamState state;
+  state.parser = &parser;
+  state.cancel = cancel;
+
+  const std::string url = OLLAMA_BASE_URL + "/api/generate";
+  struct curl_slist *headers =
+      curl_slist_append(nullptr, "Content-Type: application/json");
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_data.c_str());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, StreamWriteCallback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &state);
+  curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+  curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, StreamProgressCallback);
+  curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &state);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 120L);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
+
+  CURLcode res = curl_easy_perform(curl);
+  long http_status = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_status);
+
+  curl_slist_free_all(headers);
+  curl_easy_cleanup(curl);
+
+  if (res == CURLE_ABORTED_BY_CALLBACK) {
+    response = parser.Response();
+    return true; // Cancelled: keep the partial response
+  }
+  if (res != CURLE_OK) {
+    std::cerr << "[Ollama] curl error: " << curl_easy_strerror(res)
+              << std::endl;
+    error = "Failed to connect to Ollama. Is it running? (ollama serve)";
+    return false;
+  }
+  const bool ok = parser.Finish(http_status, error);
+  response = parser.Response();
+  return ok;
+}
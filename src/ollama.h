@@ -1,4 +1,6 @@
 #pragma once
+#include "cancellation.h"
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -19,5 +21,39 @@ std::string query_ollama_with_role(const std::string &model,
                                    const std::string &prompt,
                                    const std::string &role);
 
+// Stream a generation. on_chunk (optional) receives each piece of the
+// response as Ollama produces it; an empty system prompt uses the default
+// one of query_ollama. Stops early when cancel fires, keeping what arrived.
+// Returns false with error set if the request fails.
+bool query_ollama_stream(
+    const std::string &model, const std::string &prompt,
+    const std::string &system,
+    const std::function<void(const std::string &)> &on_chunk,
+    const CancellationToken *cancel, std::string &response, std::string &error);
+
+// Parser of the NDJSON body of a streamed generation. Feed() takes bytes as
+// they arrive and passes each response piece to on_chunk (optional).
+class OllamaStreamParser {
+public:
+  explicit OllamaStreamParser(
+      const std::function<void(const std::string &)> *on_chunk = nullptr);
+
+  void Feed(const char *data, size_t size);
+  // End of the transfer: parse a last line without a newline. Returns false
+  // with error set when Ollama reported an error or http_status is 400 or
+  // more.
+  bool Finish(long http_status, std::string &error);
+
+  const std::string &Response() const { return response; }
+
+private:
+  void ParseLine(const std::string &line);
+
+  std::string pending; // Bytes after the last complete line
+  std::string response;
+  std::string error;
+  const std::function<void(const std::string &)> *on_chunk;
+};
+
 // Check if Ollama is running
 bool is_ollama_available();
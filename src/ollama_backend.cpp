@@ -0,0 +1,23 @@
+#include "ollama_backend.h"
+#include "ollama.h"
+
+OllamaBackend::OllamaBackend(std::string model, std::string system_prompt)
+    : model(std::move(model)), systemPrompt(std::move(system_prompt)) {}
+
+BackendResult OllamaBackend::Run(const std::string &input,
+                                 const CancellationTokenPtr &cancel,
+                                 const ChunkCallback &on_chunk) {
+  BackendResult result;
+  if (!query_ollama_stream(model, input, systemPrompt, on_chunk, cancel.get(),
+                           result.output, result.error)) {
+    return result;
+  }
+  result.ok = true;
+  if (cancel && cancel->IsCancelled()) {
+    result.partial = !result.output.empty();
+    result.ok = result.partial;
+    result.error = cancel->DeadlinePassed() ? "Ollama deadline exceeded"
+                                            : "Ollama request cancelled";
+  }
+  return result;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "backend.h"
+#include <string>
+
+// Sends the input as a prompt to a local Ollama model, streaming the
+// response as it is generated
+class OllamaBackend : public Backend {
+public:
+  // An empty system prompt uses the default one
+  OllamaBackend(std::string model, std::string system_prompt = "");
+
+  std::string Kind() const override { return "ollama"; }
+
+  BackendResult Run(const std::string &input,
+                    const CancellationTokenPtr &cancel,
+                    const ChunkCallback &on_chunk) override;
+
+private:
+  std::string model;
+  std::string systemPrompt;
+};
@@ -0,0 +1,149 @@
+#include "package_installer.h"
+#include "model_quantizer.h"
+#include <array>
+#include <cstdio>
+#include <curl/curl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
+// Name of the first entry in a zip archive, read from its local file header;
+// empty if the file is not a zip
+static std::string first_zip_entry(const std::string &archive_path) {
+  std::ifstream in(archive_path, std::ios::binary);
+  std::array<unsigned char, 30> header{};
+  if (!in.read(reinterpret_cast<char *>(header.data()), header.size()) ||
+      header[0] != 'P' || header[1] != 'K' || header[2] != 3 ||
+      header[3] != 4) {
+    return "";
+  }
+  std::string name(header[26] | (header[27] << 8), '\0');
+  if (!in.read(&name[0], static_cast<std::streamsize>(name.size()))) {
+    return "";
+  }
+  return name;
+}
+
+// Run a program with the given arguments and wait for it. No shell is
+// involved, so paths are never interpreted. Returns the exit status, or -1
+// if the program could not be started.
+static int run_program(const std::vector<std::string> &args) {
+#ifdef _WIN32
+  // The CRT joins argv with spaces; Windows paths cannot contain quotes
+  std::vector<std::string> quoted;
+  for (const auto &arg : args) {
+    quoted.push_back("\"" + arg + "\"");
+  }
+  std::vector<const char *> argv;
+  for (const auto &arg : quoted) {
+    argv.push_back(arg.c_str());
+  }
+  argv.push_back(nullptr);
+  return static_cast<int>(_spawnvp(_P_WAIT, args[0].c_str(), argv.data()));
+#else
+  std::vector<char *> argv;
+  for (const auto &arg : args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+  pid_t pid;
+  if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) !=
+      0) {
+    return -1;
+  }
+  int status = 0;
+  if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)) {
+    return -1;
+  }
+  return WEXITSTATUS(status);
+#endif
+}
+
+bool InstallPackageArchive(const std::string &archive_path,
+                           const std::string &packages_dir, bool quantize,
+                           std::string &package_name, std::string &error) {
+  std::error_code ec;
+  std::filesystem::create_directories(packages_dir, ec);
+
+  // Argos archives hold a single directory named after the package
+  std::string entry = first_zip_entry(archive_path);
+  package_name = entry.substr(0, entry.find('/'));
+  if (package_name.empty() || package_name == "." || package_name == "..") {
+    error = "Not a package archive: " + archive_path;
+    return false;
+  }
+
+  if (run_program({"unzip", "-o", "-q", archive_path, "-d", packages_dir}) !=
+      0) {
+    error = "Extraction failed (install 'unzip' on system).";
+    return false;
+  }
+
+  const std::string model_dir = packages_dir + "/" + package_name + "/model";
+  if (!std::filesystem::exists(model_dir + "/model.bin")) {
+    error = "Package has no model: " + model_dir;
+    return false;
+  }
+
+  if (quantize) {
+    QuantizeStats stats;
+    if (!QuantizeModelToInt8(model_dir, &stats)) {
+      // The float model still works, just slower to load
+      std::cerr << "[WARN] Keeping float weights for " << package_name
+                << std::endl;
+    } else if (stats.quantized_variables > 0) {
+      std::cerr << "[Info] Quantized " << package_name << " to int8: "
+                << stats.bytes_before / (1024 * 1024) << " MB -> "
+                << stats.bytes_after / (1024 * 1024) << " MB" << std::endl;
+    }
+  }
+  return true;
+}
+
+static size_t write_to_file(void *contents, size_t size, size_t nmemb,
+                            void *file) {
+  return fwrite(contents, size, nmemb, static_cast<FILE *>(file));
+}
+
+bool DownloadPackageArchive(const std::string &url, const std::string &path,
+                            std::string &error) {
+  std::unique_ptr<FILE, int (*)(FILE *)> file(fopen(path.c_str(), "wb"),
+                                              fclose);
+  if (!file) {
+    error = "Cannot write " + path;
+    return false;
+  }
+  CURL *curl = curl_easy_init();
+  if (!curl) {
+    error = "Failed to initialize curl";
+    return false;
+  }
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_to_file);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, file.get());
+  const CURLcode res = curl_easy_perform(curl);
+  curl_easy_cleanup(curl);
+  const bool written = fflush(file.get()) == 0;
+  file.reset();
+
+  if (res != CURLE_OK || !written) {
+    error = "Download failed: " + url + " (" +
+            (res != CURLE_OK ? curl_easy_strerror(res) : "write error") + ")";
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+
+// Unpack an .argosmodel archive (a zip with one top-level package directory)
+// into packages_dir. With quantize set, the model is converted to int8 once
+// here so no later run has to read or convert float weights. package_name
+// receives the installed directory name; on failure error says why.
+bool InstallPackageArchive(const std::string &archive_path,
+                           const std::string &packages_dir, bool quantize,
+                           std::string &package_name, std::string &error);
+
+// Fetch url into path with libcurl, following redirects. No shell is
+// involved, so the URL (which comes from the package index) is never
+// interpreted. On failure error says why and path is removed.
+bool DownloadPackageArchive(const std::string &url, const std::string &path,
+                            std::string &error);
@@ -0,0 +1,105 @@
+#include "package_stats.h"
+#include "json.hpp"
+#include "utils.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+
+// Weight of the newest measurement in the moving averages
+static const double kSmoothing = 0.3;
+
+static double blend(double old_value, double new_value) {
+  if (old_value <= 0)
+    return new_value;
+  return old_value * (1.0 - kSmoothing) + new_value * kSmoothing;
+}
+
+PackageStats &PackageStats::GetInstance() {
+  static PackageStats instance;
+  return instance;
+}
+
+PackageStats::PackageStats() {
+  std::string path = GetStatsPath();
+  if (!std::filesystem::exists(path))
+    return;
+
+  try {
+    std::ifstream f(path);
+    json data = json::parse(f);
+    for (const auto &[name, entry] : data.items()) {
+      PackageTiming timing;
+      timing.load_ms = entry.value("load_ms", 0.0);
+      timing.ms_per_token = entry.value("ms_per_token", 0.0);
+      timing.samples = entry.value("samples", 0u);
+      timings[name] = timing;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error loading package stats: " << e.what() << std::endl;
+  }
+}
+
+std::string PackageStats::GetStatsPath() {
+  return get_config_dir() + "/package_stats.json";
+}
+
+void PackageStats::SetRecording(bool enabled) {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  recording = enabled;
+}
+
+void PackageStats::RecordLoad(const std::string &package, double ms) {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  if (!recording)
+    return;
+  auto &timing = timings[package];
+  timing.load_ms = blend(timing.load_ms, ms);
+  dirty = true;
+}
+
+void PackageStats::RecordDecode(const std::string &package, size_t sequences,
+                                size_t tokens, double ms) {
+  if (tokens == 0 || sequences == 0)
+    return;
+  std::lock_guard<std::mutex> lock(statsMutex);
+  if (!recording)
+    return;
+  // Sequences in a batch decode in parallel, so the batch time is spread
+  // over the average sequence length; a batch of one is plain ms / tokens
+  auto &timing = timings[package];
+  timing.ms_per_token = blend(timing.ms_per_token, ms * sequences / tokens);
+  timing.samples++;
+  dirty = true;
+}
+
+bool PackageStats::GetTiming(const std::string &package,
+                             PackageTiming &timing) {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  auto it = timings.find(package);
+  if (it == timings.end() || it->second.samples == 0)
+    return false;
+  timing = it->second;
+  return true;
+}
+
+void PackageStats::Save() {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  if (!dirty || !recording)
+    return;
+
+  try {
+    json data;
+    for (const auto &[name, timing] : timings) {
+      data[name] = {{"load_ms", timing.load_ms},
+                    {"ms_per_token", timing.ms_per_token},
+                    {"samples", timing.samples}};
+    }
+    std::ofstream f(GetStatsPath());
+    f << data.dump(2);
+    dirty = false;
+  } catch (const std::exception &e) {
+    std::cerr << "Error saving package stats: " << e.what() << std::endl;
+  }
+}
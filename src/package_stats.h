@@ -0,0 +1,49 @@
+#ifndef PACKAGE_STATS_H
+#define PACKAGE_STATS_H
+
+#include <map>
+#include <mutex>
+#include <string>
+
+struct PackageTiming {
+  double load_ms = 0;        // Time to load the model
+  double ms_per_token = 0;   // Decode time per token of one sequence
+  unsigned int samples = 0;  // Number of measured runs
+};
+
+// Measured load time and decode speed per package, persisted in
+// ~/.config/fast-translator/package_stats.json so routing can prefer
+// packages that are actually fast on this machine.
+class PackageStats {
+public:
+  static PackageStats &GetInstance();
+
+  void RecordLoad(const std::string &package, double ms);
+  // ms is the wall time of one batch of sequences decoded side by side,
+  // which generated tokens in total
+  void RecordDecode(const std::string &package, size_t sequences,
+                    size_t tokens, double ms);
+
+  // Off for synthetic backends, whose timings say nothing about the real
+  // models: nothing is recorded or saved, stored timings are still read
+  void SetRecording(bool enabled);
+
+  // Returns false if the package was never measured
+  bool GetTiming(const std::string &package, PackageTiming &timing);
+
+  void Save();
+
+private:
+  PackageStats();
+  PackageStats(const PackageStats &) = delete;
+  PackageStats &operator=(const PackageStats &) = delete;
+
+  std::string GetStatsPath();
+
+  std::map<std::string, PackageTiming> timings;
+  bool dirty = false;
+  bool recording = true;
+  std::mutex statsMutex;
+};
+
+#endif
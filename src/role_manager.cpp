@@ -1,6 +1,6 @@
 #include "role_manager.h"
 #include "json.hpp"
-#include <cstdlib>
+#include "utils.h"
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -14,17 +14,7 @@ RoleManager &RoleManager::GetInstance() {
 
 RoleManager::RoleManager() { LoadRoles(); }
 
-std::string RoleManager::GetConfigDir() {
-  const char *home = std::getenv("HOME");
-  if (!home)
-    return "."; // Fallback to current dir
-
-  std::string configDir = std::string(home) + "/.config/fast-translator";
-  if (!std::filesystem::exists(configDir)) {
-    std::filesystem::create_directories(configDir);
-  }
-  return configDir;
-}
+std::string RoleManager::GetConfigDir() { return get_config_dir(); }
 
 std::string RoleManager::GetConfigPath() {
   return GetConfigDir() + "/roles.json";
@@ -0,0 +1,473 @@
+#include "subtitle_translator.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// One blank-line separated block of the file. Blocks without a timing line
+// (WEBVTT header, NOTE, STYLE) are kept verbatim in head.
+struct Block {
+  std::vector<std::string> head; // Identifier and timing line
+  std::vector<std::string> text; // Cue text lines
+  bool is_cue = false;
+  long start_ms = -1;
+  long end_ms = -1;
+  bool dialogue = false;         // Every line starts with '-'
+  std::string open_tags;         // Formatting wrapped around the whole cue,
+  std::string close_tags;        // e.g. "<i>" ... "</i>" or "{\an8}"
+  std::string plain;             // Text without tags, lines joined by spaces
+};
+
+// A sentence for the model: consecutive cues, or one line of a dialogue cue
+struct Unit {
+  std::vector<size_t> cues;
+  size_t line = std::string::npos;
+};
+
+std::string trim(const std::string &text) {
+  const size_t begin = text.find_first_not_of(" \t\r");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  const size_t end = text.find_last_not_of(" \t\r");
+  return text.substr(begin, end - begin + 1);
+}
+
+// "01:02:03,456" (SRT) or "02:03.456" (VTT) in milliseconds, -1 if invalid
+long parse_timestamp(const std::string &text) {
+  long parts[3] = {0, 0, 0};
+  int count = 0;
+  size_t pos = 0;
+  while (count < 3) {
+    size_t used = 0;
+    try {
+      parts[count++] = std::stol(text.substr(pos), &used);
+    } catch (const std::exception &) {
+      return -1;
+    }
+    pos += used;
+    if (pos >= text.size() || text[pos] != ':') {
+      break;
+    }
+    pos++;
+  }
+  if (pos >= text.size() || (text[pos] != ',' && text[pos] != '.')) {
+    return -1;
+  }
+  long millis = 0;
+  try {
+    millis = std::stol(text.substr(pos + 1, 3));
+  } catch (const std::exception &) {
+    return -1;
+  }
+  long seconds = 0;
+  for (int i = 0; i < count; i++) {
+    seconds = seconds * 60 + parts[i];
+  }
+  return seconds * 1000 + millis;
+}
+
+void parse_timing(const std::string &line, long &start_ms, long &end_ms) {
+  const size_t arrow = line.find("-->");
+  std::istringstream after(line.substr(arrow + 3));
+  std::string end;
+  after >> end;
+  start_ms = parse_timestamp(trim(line.substr(0, arrow)));
+  end_ms = parse_timestamp(end);
+}
+
+// Leading or trailing "<i>", "</font>", "{\an8}" runs
+size_t leading_tags(const std::string &text) {
+  size_t pos = 0;
+  while (pos < text.size() && (text[pos] == '<' || text[pos] == '{')) {
+    const size_t close = text.find(text[pos] == '<' ? '>' : '}', pos);
+    if (close == std::string::npos) {
+      break;
+    }
+    pos = close + 1;
+  }
+  return pos;
+}
+
+size_t trailing_tags(const std::string &text) {
+  size_t end = text.size();
+  while (end > 0 && (text[end - 1] == '>' || text[end - 1] == '}')) {
+    const size_t open = text.rfind(text[end - 1] == '>' ? '<' : '{', end - 1);
+    if (open == std::string::npos) {
+      break;
+    }
+    end = open;
+  }
+  return text.size() - end;
+}
+
+// Only the "{...}" tags of a run of tags
+std::string brace_tags(const std::string &tags) {
+  std::string result;
+  size_t pos = 0;
+  while ((pos = tags.find('{', pos)) != std::string::npos) {
+    const size_t close = tags.find('}', pos);
+    if (close == std::string::npos) {
+      break;
+    }
+    result += tags.substr(pos, close + 1 - pos);
+    pos = close + 1;
+  }
+  return result;
+}
+
+// Length of the tags and "- " before the words of a dialogue line
+size_t dialogue_prefix(const std::string &line) {
+  const size_t text = line.find_first_not_of("- ", leading_tags(line));
+  return text == std::string::npos ? line.size() : text;
+}
+
+std::string strip_tags(const std::string &text) {
+  std::string result;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '<' || text[i] == '{') {
+      const size_t close = text.find(text[i] == '<' ? '>' : '}', i);
+      if (close != std::string::npos) {
+        i = close;
+        continue;
+      }
+    }
+    result += text[i];
+  }
+  return trim(result);
+}
+
+void prepare_cue(Block &block) {
+  block.dialogue = block.text.size() > 1;
+  for (const auto &line : block.text) {
+    if (strip_tags(line).compare(0, 1, "-") != 0) {
+      block.dialogue = false;
+    }
+  }
+
+  const std::string &first = block.text.front();
+  const std::string &last = block.text.back();
+  block.open_tags = first.substr(0, leading_tags(first));
+  block.close_tags = last.substr(last.size() - trailing_tags(last));
+  // HTML-style tags are only kept when they wrap the whole cue; "{\an8}"
+  // style overrides need no closing
+  if (block.open_tags.find('<') == std::string::npos ||
+      block.close_tags.find('<') == std::string::npos) {
+    block.open_tags = brace_tags(block.open_tags);
+    block.close_tags = brace_tags(block.close_tags);
+  }
+
+  std::string joined;
+  for (const auto &line : block.text) {
+    const std::string plain = strip_tags(line);
+    if (!plain.empty()) {
+      joined += (joined.empty() ? "" : " ") + plain;
+    }
+  }
+  block.plain = joined;
+}
+
+std::vector<Block> parse_blocks(const std::string &content) {
+  std::vector<Block> blocks;
+  std::vector<std::string> lines;
+  std::istringstream in(content);
+  std::string line;
+
+  auto flush = [&]() {
+    if (lines.empty()) {
+      return;
+    }
+    Block block;
+    auto timing = std::find_if(lines.begin(), lines.end(), [](const auto &l) {
+      return l.find("-->") != std::string::npos;
+    });
+    if (timing == lines.end() || timing + 1 == lines.end()) {
+      block.head = lines;
+    } else {
+      block.is_cue = true;
+      block.head.assign(lines.begin(), timing + 1);
+      block.text.assign(timing + 1, lines.end());
+      parse_timing(*timing, block.start_ms, block.end_ms);
+      prepare_cue(block);
+    }
+    blocks.push_back(std::move(block));
+    lines.clear();
+  };
+
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (trim(line).empty()) {
+      flush();
+    } else {
+      lines.push_back(line);
+    }
+  }
+  flush();
+  return blocks;
+}
+
+// Whether a cue's text reads as a finished sentence
+bool ends_sentence(const std::string &text) {
+  size_t end = text.size();
+  while (end > 0 && std::string("\"')]").find(text[end - 1]) !=
+                        std::string::npos) {
+    end--;
+  }
+  if (end == 0) {
+    return true;
+  }
+  const std::string tail = text.substr(0, end);
+  const char last = tail.back();
+  if (last == '.' || last == '!' || last == '?' || last == ':' ||
+      last == ';') {
+    return true;
+  }
+  // "…", "♪" and full-width "。！？"
+  for (const char *mark : {"\xE2\x80\xA6", "\xE2\x99\xAA", "\xE3\x80\x82",
+                           "\xEF\xBC\x81", "\xEF\xBC\x9F"}) {
+    const std::string m(mark);
+    if (tail.size() >= m.size() &&
+        tail.compare(tail.size() - m.size(), m.size(), m) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<std::string> split_words(const std::string &text) {
+  std::vector<std::string> words;
+  std::istringstream in(text);
+  std::string word;
+  while (in >> word) {
+    words.push_back(word);
+  }
+  return words;
+}
+
+std::string join_words(const std::vector<std::string> &words, size_t begin,
+                       size_t end) {
+  std::string text;
+  for (size_t i = begin; i < end; i++) {
+    text += (i > begin ? " " : "") + words[i];
+  }
+  return text;
+}
+
+// Split text over parts in proportion to weights, at word boundaries, giving
+// every part at least one word while words last
+std::vector<std::string>
+split_proportionally(const std::string &text,
+                     const std::vector<size_t> &weights) {
+  const std::vector<std::string> words = split_words(text);
+  const size_t parts = weights.size();
+  std::vector<std::string> result(parts);
+
+  size_t total_weight = 0;
+  for (size_t weight : weights) {
+    total_weight += std::max<size_t>(1, weight);
+  }
+  size_t total_chars = 0;
+  for (const auto &word : words) {
+    total_chars += word.size() + 1;
+  }
+
+  size_t begin = 0;
+  size_t chars = 0;
+  size_t cumulative_weight = 0;
+  for (size_t p = 0; p < parts; p++) {
+    cumulative_weight += std::max<size_t>(1, weights[p]);
+    const size_t remaining_parts = parts - p - 1;
+    size_t end = begin;
+    if (p + 1 == parts) {
+      end = words.size();
+    } else {
+      const double target =
+          double(total_chars) * cumulative_weight / total_weight;
+      // Take words while the midpoint of the next one is within the target
+      while (end < words.size() &&
+             chars + (words[end].size() + 1) / 2.0 <= target) {
+        chars += words[end++].size() + 1;
+      }
+      const size_t min_end = std::min(words.size(), begin + 1);
+      const size_t max_end = words.size() > remaining_parts
+                                 ? words.size() - remaining_parts
+                                 : words.size();
+      while (end < min_end) {
+        chars += words[end++].size() + 1;
+      }
+      while (end > max_end && end > min_end) {
+        chars -= words[--end].size() + 1;
+      }
+    }
+    result[p] = join_words(words, begin, end);
+    begin = end;
+  }
+  return result;
+}
+
+// Break text into count lines of similar length at spaces
+std::vector<std::string> wrap_lines(const std::string &text, size_t count) {
+  const std::vector<std::string> words = split_words(text);
+  if (count <= 1 || words.size() < 2) {
+    return {text};
+  }
+  count = std::min(count, words.size());
+  return split_proportionally(text, std::vector<size_t>(count, 1));
+}
+
+bool write_file(const std::string &path, const std::string &content) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(content.data(), static_cast<std::streamsize>(content.size()));
+  return static_cast<bool>(out);
+}
+
+} // namespace
+
+bool TranslateSubtitles(const std::string &input_path,
+                        const std::string &output_path,
+                        TranslationChain &chain,
+                        const SubtitleOptions &options) {
+  std::ifstream in(input_path, std::ios::binary);
+  if (!in.is_open()) {
+    std::cerr << "[ERROR] Cannot open subtitle file " << input_path
+              << std::endl;
+    return false;
+  }
+  std::string content((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+
+  const std::string bom = "\xEF\xBB\xBF";
+  const bool has_bom = content.compare(0, bom.size(), bom) == 0;
+  if (has_bom) {
+    content.erase(0, bom.size());
+  }
+  const std::string newline =
+      content.find("\r\n") != std::string::npos ? "\r\n" : "\n";
+
+  std::vector<Block> blocks = parse_blocks(content);
+
+  // Group cues into sentences
+  std::vector<Unit> units;
+  size_t cue_count = 0;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const Block &block = blocks[i];
+    if (!block.is_cue || block.plain.empty()) {
+      continue;
+    }
+    cue_count++;
+    if (block.dialogue) {
+      for (size_t line = 0; line < block.text.size(); line++) {
+        units.push_back(Unit{{i}, line});
+      }
+      continue;
+    }
+
+    bool merged = false;
+    if (!units.empty() && units.back().line == std::string::npos &&
+        units.back().cues.size() < options.max_merge_cues) {
+      const Block &previous = blocks[units.back().cues.back()];
+      const long gap = block.start_ms - previous.end_ms;
+      if (!ends_sentence(previous.plain) && previous.end_ms >= 0 &&
+          block.start_ms >= 0 && gap <= options.max_merge_gap_ms) {
+        units.back().cues.push_back(i);
+        merged = true;
+      }
+    }
+    if (!merged) {
+      units.push_back(Unit{{i}, std::string::npos});
+    }
+  }
+
+  std::vector<std::string> segments;
+  segments.reserve(units.size());
+  for (const auto &unit : units) {
+    if (unit.line != std::string::npos) {
+      // Dialogue line without its "- "
+      const std::string &line = blocks[unit.cues[0]].text[unit.line];
+      segments.push_back(strip_tags(line.substr(dialogue_prefix(line))));
+    } else {
+      std::string text;
+      for (size_t cue : unit.cues) {
+        text += (text.empty() ? "" : " ") + blocks[cue].plain;
+      }
+      segments.push_back(text);
+    }
+  }
+
+  std::cerr << "[Info] " << cue_count << " cues form " << segments.size()
+            << " sentences" << std::endl;
+
+  // Translate every sentence with the models loaded once
+  std::vector<std::string> translated;
+  translated.reserve(segments.size());
+  const size_t batch = std::max<size_t>(1, options.batch_segments);
+  for (size_t start = 0; start < segments.size(); start += batch) {
+    const size_t end = std::min(segments.size(), start + batch);
+    std::vector<std::string> slice(segments.begin() + start,
+                                   segments.begin() + end);
+    std::vector<std::string> result = chain.TranslateBatch(slice);
+    if (!chain.GetError().empty()) {
+      std::cerr << "[ERROR] Translation batch failed at sentence " << start
+                << ": " << chain.GetError() << std::endl;
+      return false;
+    }
+    translated.insert(translated.end(), result.begin(), result.end());
+    std::cerr << "[Info] Translated " << end << " / " << segments.size()
+              << " sentences" << std::endl;
+  }
+
+  // Put translations back on the original cues and lines
+  for (size_t u = 0; u < units.size(); u++) {
+    const Unit &unit = units[u];
+    if (unit.line != std::string::npos) {
+      std::string &line = blocks[unit.cues[0]].text[unit.line];
+      const size_t prefix = dialogue_prefix(line);
+      const size_t suffix =
+          std::min(trailing_tags(line), line.size() - prefix);
+      line = line.substr(0, prefix) + translated[u] +
+             line.substr(line.size() - suffix);
+      continue;
+    }
+
+    std::vector<size_t> weights;
+    for (size_t cue : unit.cues) {
+      weights.push_back(blocks[cue].plain.size());
+    }
+    std::vector<std::string> parts =
+        split_proportionally(translated[u], weights);
+    for (size_t k = 0; k < unit.cues.size(); k++) {
+      Block &block = blocks[unit.cues[k]];
+      // A cue must not be left empty: a blank line would end the block
+      std::vector<std::string> lines = wrap_lines(
+          parts[k].empty() ? "..." : parts[k], block.text.size());
+      lines.front() = block.open_tags + lines.front();
+      lines.back() += block.close_tags;
+      block.text = lines;
+    }
+  }
+
+  std::string output = has_bom ? bom : "";
+  for (size_t i = 0; i < blocks.size(); i++) {
+    if (i > 0) {
+      output += newline;
+    }
+    for (const auto &line : blocks[i].head) {
+      output += line + newline;
+    }
+    for (const auto &line : blocks[i].text) {
+      output += line + newline;
+    }
+  }
+
+  if (!write_file(output_path, output)) {
+    std::cerr << "[ERROR] Failed writing " << output_path << std::endl;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "translation_chain.h"
+#include <cstddef>
+#include <string>
+
+struct SubtitleOptions {
+  // Segments sent to the chain per translate_batch call
+  size_t batch_segments = 32;
+  // Most cues joined into one sentence for the model
+  size_t max_merge_cues = 4;
+  // Cues further apart than this are never joined
+  long max_merge_gap_ms = 1500;
+};
+
+// Translate an SRT or WebVTT file. Cues that continue one sentence are
+// joined so the model sees it whole, every sentence of the file goes
+// through the chain in batches, and each translation is split back over
+// its cues in proportion to their original length, keeping every index,
+// timing line, cue setting and the line count of each cue. Dialogue cues
+// ("- Hi.\n- Hello.") are translated line by line.
+bool TranslateSubtitles(const std::string &input_path,
+                        const std::string &output_path,
+                        TranslationChain &chain,
+                        const SubtitleOptions &options = SubtitleOptions());
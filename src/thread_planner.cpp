@@ -0,0 +1,193 @@
+#include "thread_planner.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// Heuristic, not a measured cost model: every thread should get at least
+// this many tokens of work (tokens * batch) per decoding step, since each
+// step synchronizes all of them. A single word or short sentence decodes on
+// one thread, a 32-segment batch of sentences fills the budget.
+static const size_t kTokensPerThread = 64;
+
+size_t EstimateTokens(const std::string &text) {
+  // Subword vocabularies average roughly four bytes per token
+  return (text.size() + 3) / 4;
+}
+
+#ifdef __linux__
+// Count CPUs in a cpuset list such as "0-3,8,10-11"
+static size_t count_cpu_list(const std::string &list) {
+  size_t count = 0;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || range == "\n")
+      continue;
+    size_t dash = range.find('-');
+    try {
+      if (dash == std::string::npos) {
+        std::stoul(range);
+        count++;
+      } else {
+        unsigned long first = std::stoul(range.substr(0, dash));
+        unsigned long last = std::stoul(range.substr(dash + 1));
+        if (last >= first)
+          count += last - first + 1;
+      }
+    } catch (...) {
+      return 0; // Unparseable, ignore this limit
+    }
+  }
+  return count;
+}
+
+static bool read_first_line(const std::string &path, std::string &line) {
+  std::ifstream file(path);
+  return file.is_open() && std::getline(file, line) && !line.empty();
+}
+
+// Cgroup paths of this process: controller -> path ("" key for cgroup v2)
+static std::vector<std::pair<std::string, std::string>> read_own_cgroups() {
+  std::vector<std::pair<std::string, std::string>> cgroups;
+  std::ifstream file("/proc/self/cgroup");
+  std::string line;
+  while (std::getline(file, line)) {
+    // Format: hierarchy-id:controller-list:path
+    size_t first = line.find(':');
+    size_t second = line.find(':', first + 1);
+    if (first == std::string::npos || second == std::string::npos)
+      continue;
+    cgroups.emplace_back(line.substr(first + 1, second - first - 1),
+                         line.substr(second + 1));
+  }
+  return cgroups;
+}
+
+// Directories to check for a controller, from the process's own cgroup up to
+// the root of the hierarchy (limits of any ancestor apply too)
+static std::vector<std::string> cgroup_dirs(const std::string &mount,
+                                            const std::string &path) {
+  std::vector<std::string> dirs;
+  std::string current = path;
+  while (!current.empty() && current != "/") {
+    dirs.push_back(mount + current);
+    current = current.substr(0, current.find_last_of('/'));
+  }
+  dirs.push_back(mount);
+  return dirs;
+}
+
+// CPU limit from cgroup quotas and cpusets, 0 if unlimited or unknown
+static size_t get_cgroup_cpu_limit() {
+  size_t limit = 0;
+  auto apply = [&limit](size_t cpus) {
+    if (cpus > 0 && (limit == 0 || cpus < limit))
+      limit = cpus;
+  };
+
+  for (const auto &[controllers, path] : read_own_cgroups()) {
+    std::string line;
+    if (controllers.empty()) {
+      // cgroup v2: "max 100000" or "<quota> <period>"
+      for (const auto &dir : cgroup_dirs("/sys/fs/cgroup", path)) {
+        if (read_first_line(dir + "/cpu.max", line)) {
+          std::stringstream ss(line);
+          std::string quota;
+          double period = 0;
+          ss >> quota >> period;
+          if (quota != "max" && period > 0) {
+            apply(static_cast<size_t>(std::ceil(std::stod(quota) / period)));
+          }
+        }
+        if (read_first_line(dir + "/cpuset.cpus.effective", line)) {
+          apply(count_cpu_list(line));
+        }
+      }
+      continue;
+    }
+
+    // cgroup v1: quota in cpu (often mounted as cpu,cpuacct), cpus in cpuset
+    std::stringstream list(controllers);
+    std::string controller;
+    while (std::getline(list, controller, ',')) {
+      if (controller == "cpu") {
+        const std::string mounts[] = {"/sys/fs/cgroup/cpu",
+                                      "/sys/fs/cgroup/" + controllers};
+        for (const auto &mount : mounts) {
+          for (const auto &dir : cgroup_dirs(mount, path)) {
+            std::string period_line;
+            if (read_first_line(dir + "/cpu.cfs_quota_us", line) &&
+                read_first_line(dir + "/cpu.cfs_period_us", period_line)) {
+              double quota = std::stod(line);
+              double period = std::stod(period_line);
+              if (quota > 0 && period > 0) {
+                apply(static_cast<size_t>(std::ceil(quota / period)));
+              }
+            }
+          }
+        }
+      } else if (controller == "cpuset") {
+        for (const auto &dir : cgroup_dirs("/sys/fs/cgroup/cpuset", path)) {
+          if (read_first_line(dir + "/cpuset.effective_cpus", line) ||
+              read_first_line(dir + "/cpuset.cpus", line)) {
+            apply(count_cpu_list(line));
+            break; // The innermost cpuset is already the effective one
+          }
+        }
+      }
+    }
+  }
+  return limit;
+}
+#endif
+
+size_t GetAvailableCpus() {
+  unsigned int hw_threads = std::thread::hardware_concurrency();
+  if (hw_threads == 0)
+    hw_threads = 4; // Fallback if detection fails
+  size_t cpus = hw_threads;
+
+#ifdef __linux__
+  // hardware_concurrency() counts every CPU on the host, but containers are
+  // limited by the affinity mask, cpusets and CFS quotas
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+    size_t allowed = static_cast<size_t>(CPU_COUNT(&mask));
+    if (allowed > 0)
+      cpus = std::min(cpus, allowed);
+  }
+
+  try {
+    size_t cgroup_limit = get_cgroup_cpu_limit();
+    if (cgroup_limit > 0)
+      cpus = std::min(cpus, cgroup_limit);
+  } catch (const std::exception &) {
+    // Malformed cgroup files: keep the affinity-based count
+  }
+#endif
+
+  return std::max<size_t>(1, cpus);
+}
+
+size_t PlanThreads(const Workload &workload, size_t available_cpus) {
+  available_cpus = std::max<size_t>(1, available_cpus);
+
+  // Use 75% of cores, but at least 1 and leave at least 1 for system
+  size_t budget = std::max<size_t>(1, available_cpus * 3 / 4);
+  if (available_cpus > 1)
+    budget = std::min(budget, available_cpus - 1);
+
+  if (workload.tokens == 0)
+    return budget; // Unknown workload: take the whole budget
+
+  const size_t work = workload.tokens * std::max<size_t>(1, workload.batch);
+  return std::clamp<size_t>((work + kTokensPerThread - 1) / kTokensPerThread,
+                            1, budget);
+}
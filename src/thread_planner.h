@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Expected size of the work a model will do; zero tokens means unknown
+struct Workload {
+  size_t tokens = 0;    // Source tokens per segment
+  size_t batch = 1;     // Segments decoded together
+};
+
+// Rough token count for text that has not been tokenized yet
+size_t EstimateTokens(const std::string &text);
+
+// CPUs this process may actually use: the host count limited by the affinity
+// mask and, on Linux, by cgroup v1/v2 CPU quotas and cpusets
+size_t GetAvailableCpus();
+
+// Intra-op threads for a workload: one per 64 tokens of work, so small
+// inputs decode on a single thread, capped at a budget of ~75% of available
+// CPUs, which large batches and unknown workloads get in full.
+size_t PlanThreads(const Workload &workload, size_t available_cpus);
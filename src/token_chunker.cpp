@@ -0,0 +1,89 @@
+#include "token_chunker.h"
+
+namespace {
+
+const std::string kSpMarker = "\xE2\x96\x81"; // ▁
+
+enum Boundary { kNone = 0, kWord = 1, kClause = 2, kSentence = 3 };
+
+bool StartsWith(const std::string &s, const std::string &prefix) {
+  return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool EndsWith(const std::string &s, const std::string &suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Strength of a cut placed right after tokens[i]
+Boundary BoundaryAfter(const std::vector<std::string> &tokens, size_t i,
+                       bool sentencepiece) {
+  const std::string &token = tokens[i];
+
+  // Never split inside a word: BPE continues with "@@", SentencePiece
+  // starts every new word with "▁"
+  if (EndsWith(token, "@@"))
+    return kNone;
+  if (sentencepiece && i + 1 < tokens.size() &&
+      !StartsWith(tokens[i + 1], kSpMarker))
+    return kNone;
+
+  static const char *sentence_ends[] = {".", "!", "?", "\xE3\x80\x82",
+                                        "\xEF\xBC\x81", "\xEF\xBC\x9F"};
+  static const char *clause_ends[] = {",", ";", ":", "\xE3\x80\x81",
+                                      "\xEF\xBC\x8C", "\xEF\xBC\x9B"};
+  for (const char *end : sentence_ends) {
+    if (EndsWith(token, end))
+      return kSentence;
+  }
+  for (const char *end : clause_ends) {
+    if (EndsWith(token, end))
+      return kClause;
+  }
+  return kWord;
+}
+
+} // namespace
+
+std::vector<TokenRange> ChunkTokens(const std::vector<std::string> &tokens,
+                                    size_t max_tokens) {
+  std::vector<TokenRange> ranges;
+  if (max_tokens == 0 || tokens.size() <= max_tokens) {
+    ranges.emplace_back(0, tokens.size());
+    return ranges;
+  }
+
+  bool sentencepiece = false;
+  for (const auto &token : tokens) {
+    if (StartsWith(token, kSpMarker)) {
+      sentencepiece = true;
+      break;
+    }
+  }
+
+  size_t start = 0;
+  while (tokens.size() - start > max_tokens) {
+    const size_t limit = start + max_tokens;
+    // Prefer strong boundaries in the second half of the window so chunks do
+    // not become tiny; fall back to any word boundary, then a hard cut
+    const size_t lower = start + (max_tokens + 1) / 2;
+    size_t cut = 0;
+
+    for (int wanted = kSentence; wanted >= kWord && cut == 0; wanted--) {
+      const size_t floor = (wanted == kWord) ? start + 1 : lower;
+      for (size_t end = limit; end >= floor; end--) {
+        if (BoundaryAfter(tokens, end - 1, sentencepiece) >= wanted) {
+          cut = end;
+          break;
+        }
+      }
+    }
+    if (cut == 0)
+      cut = limit;
+
+    ranges.emplace_back(start, cut);
+    start = cut;
+  }
+  ranges.emplace_back(start, tokens.size());
+  return ranges;
+}
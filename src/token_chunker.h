@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Half-open [begin, end) range of token indices
+using TokenRange = std::pair<size_t, size_t>;
+
+// Split a tokenized sequence into chunks of at most max_tokens tokens.
+// Cuts prefer the end of a sentence, then a clause, then a word boundary,
+// so each chunk can be translated on its own. Returns a single range when
+// the sequence already fits (or max_tokens is 0).
+std::vector<TokenRange> ChunkTokens(const std::vector<std::string> &tokens,
+                                    size_t max_tokens);
@@ -0,0 +1,36 @@
+#include "tokenizer.h"
+#include "tokenizer_bpe.h"
+#include "tokenizer_sp.h"
+
+std::unique_ptr<Tokenizer> CreateTokenizer(const std::string &model_path) {
+  if (model_path.find("sentencepiece.model") != std::string::npos) {
+    return std::make_unique<SentencePieceTokenizer>();
+  }
+  // Assume legacy BPE if not sentencepiece
+  return std::make_unique<LegacyBPETokenizer>();
+}
+
+std::vector<std::string> Tokenizer::encode(const std::string &text) {
+  thread_local TokenBuffer tokens;
+  encode(text, tokens);
+  std::vector<std::string> pieces;
+  pieces.reserve(tokens.size());
+  for (size_t i = 0; i < tokens.size(); i++) {
+    pieces.emplace_back(tokens.piece(i));
+  }
+  return pieces;
+}
+
+std::string Tokenizer::decode(const std::vector<std::string> &tokens) {
+  thread_local TokenBuffer buffer;
+  buffer.clear();
+  size_t size = 0;
+  for (const auto &token : tokens) {
+    buffer.push_back(-1, token);
+    size += token.size() + 1;
+  }
+  std::string text;
+  text.reserve(size);
+  decode(buffer, text);
+  return text;
+}
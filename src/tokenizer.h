@@ -1,11 +1,58 @@
 #pragma once
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Tokens of one text: vocabulary ids and their pieces, stored back to back
+// in a single string. Callers keep a buffer and reuse it, so tokenizing
+// stops allocating once it has grown to the largest input. Ids belong to
+// the tokenizer that produced them; -1 means "look the piece up".
+class TokenBuffer {
+public:
+    void clear() {
+        token_ids.clear();
+        piece_ends.clear();
+        pieces.clear();
+    }
+
+    void push_back(int id, std::string_view piece) {
+        token_ids.push_back(id);
+        pieces.append(piece.data(), piece.size());
+        piece_ends.push_back(pieces.size());
+    }
+
+    size_t size() const { return token_ids.size(); }
+    bool empty() const { return token_ids.empty(); }
+    int id(size_t i) const { return token_ids[i]; }
+    std::string_view piece(size_t i) const {
+        const size_t start = i ? piece_ends[i - 1] : 0;
+        return std::string_view(pieces).substr(start, piece_ends[i] - start);
+    }
+    const std::vector<int>& ids() const { return token_ids; }
+
+private:
+    std::vector<int> token_ids;
+    std::vector<size_t> piece_ends;
+    std::string pieces;
+};
+
 class Tokenizer {
 public:
     virtual ~Tokenizer() = default;
     virtual bool load(const std::string& model_path) = 0;
-    virtual std::vector<std::string> encode(const std::string& text) = 0;
-    virtual std::string decode(const std::vector<std::string>& tokens) = 0;
+
+    // Replace the contents of tokens with the tokens of text
+    virtual void encode(std::string_view text, TokenBuffer& tokens) = 0;
+    // Append the detokenized text of tokens to text
+    virtual void decode(const TokenBuffer& tokens, std::string& text) = 0;
+
+    // String forms on top of the buffer ones, for callers that keep the
+    // pieces (CTranslate2 takes and returns strings)
+    std::vector<std::string> encode(const std::string& text);
+    std::string decode(const std::vector<std::string>& tokens);
 };
+
+// Pick the tokenizer implementation matching a package's tokenizer model file
+// (the model still has to be loaded with load())
+std::unique_ptr<Tokenizer> CreateTokenizer(const std::string& model_path);
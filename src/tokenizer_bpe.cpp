@@ -1,150 +1,552 @@
 #include "tokenizer_bpe.h"
+#include "moses_tokenizer.h"
+#include "utf8_scan.h"
+#include "utils.h"
+#include <cstring>
+#include <deque>
+#include <filesystem>
 #include <iterator>
+#include <numeric>
 
-bool LegacyBPETokenizer::load(const std::string& model_path) {
-    std::ifstream file(model_path);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open BPE model: " << model_path << std::endl;
-        return false;
+// Words per cache generation; the cache holds at most two generations
+static const size_t kCacheGeneration = 32768;
+// Longer "words" (URLs, base64, ...) rarely repeat and are not cached
+static const size_t kMaxCachedWord = 64;
+
+LegacyBPETokenizer::~LegacyBPETokenizer() {
+    save_cache();
+}
+
+namespace {
+
+const char kMergesMagic[8] = {'F', 'T', 'B', 'P', 'E', '2', '\0', '\0'};
+
+struct CompiledHeader {
+    char magic[8];
+    uint32_t symbol_count;
+    uint32_t slot_count;
+    uint64_t source_size;
+    int64_t source_mtime;
+    char source_hash[16];
+};
+static_assert(sizeof(CompiledHeader) == 48, "Compiled header must be packed");
+
+struct SymbolEntry {
+    uint32_t offset;
+    uint32_t length;
+};
+
+// Size and modification time of the merges file a table was compiled from
+bool source_stamp(const std::string& path, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    size = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    mtime = std::filesystem::last_write_time(path, ec)
+                .time_since_epoch()
+                .count();
+    return !ec;
+}
+
+// First two whitespace-separated fields of a merges line
+bool split_merge_line(const std::string& line, std::string& left,
+                      std::string& right) {
+    static const char* const kSpace = " \t\r";
+    const size_t left_start = line.find_first_not_of(kSpace);
+    if (left_start == std::string::npos) return false;
+    const size_t left_end = line.find_first_of(kSpace, left_start);
+    if (left_end == std::string::npos) return false;
+    const size_t right_start = line.find_first_not_of(kSpace, left_end);
+    if (right_start == std::string::npos) return false;
+    const size_t right_end = line.find_first_of(kSpace, right_start);
+    left.assign(line, left_start, left_end - left_start);
+    right.assign(line, right_start,
+                 right_end == std::string::npos ? std::string::npos
+                                                : right_end - right_start);
+    return true;
+}
+
+// Interns the symbols of a merges file and lays them out as a compiled table
+class MergesBuilder {
+public:
+    void add(const std::string& left, const std::string& right, int rank) {
+        const int left_id = intern(left);
+        const int right_id = intern(right);
+        // A repeated pair keeps its last rank
+        merges[BpeRankTable::PairKey(left_id, right_id)] = {
+            rank, intern(left + right)};
     }
 
-    std::string line;
-    // Skip version line if present
-    if (std::getline(file, line)) {
-        if (line.rfind("#version", 0) != 0) {
-           // Not a version line, process it
-           // Reset to beginning? Or just process. 
-           // Usually first line is version.
-           if (line.find("#") == 0) { 
-               // comment, ignore
-           } else {
-               // process line
-               std::stringstream ss(line);
-               std::string p1, p2;
-               ss >> p1 >> p2;
-               if (!p1.empty() && !p2.empty()) bpe_ranks[{p1, p2}] = 0;
-           }
+    std::vector<char> build(CompiledHeader header) const {
+        // Ids become positions in text order, so lookups binary search
+        std::vector<int> order(symbols.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(),
+                  [this](int a, int b) { return symbols[a] < symbols[b]; });
+        std::vector<int> sorted_id(symbols.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            sorted_id[order[i]] = static_cast<int>(i);
+        }
+
+        std::vector<SymbolEntry> index;
+        std::string blob;
+        index.reserve(symbols.size());
+        for (int id : order) {
+            index.push_back({static_cast<uint32_t>(blob.size()),
+                             static_cast<uint32_t>(symbols[id].size())});
+            blob += symbols[id];
         }
+
+        std::vector<std::pair<uint64_t, BpeMerge>> entries;
+        entries.reserve(merges.size());
+        for (const auto& [key, merge] : merges) {
+            const int left = sorted_id[key >> 32];
+            const int right = sorted_id[key & 0xFFFFFFFFu];
+            entries.push_back({BpeRankTable::PairKey(left, right),
+                               {merge.first, sorted_id[merge.second]}});
+        }
+        const auto slots = BpeRankTable::Build(entries);
+
+        std::memcpy(header.magic, kMergesMagic, sizeof(kMergesMagic));
+        header.symbol_count = static_cast<uint32_t>(index.size());
+        header.slot_count = static_cast<uint32_t>(slots.size());
+
+        std::vector<char> image;
+        auto append = [&image](const void* data, size_t size) {
+            const char* bytes = static_cast<const char*>(data);
+            image.insert(image.end(), bytes, bytes + size);
+        };
+        append(&header, sizeof(header));
+        append(index.data(), index.size() * sizeof(SymbolEntry));
+        append(slots.data(), slots.size() * sizeof(BpeRankTable::Slot));
+        append(blob.data(), blob.size());
+        return image;
+    }
+
+private:
+    int intern(const std::string& symbol) {
+        auto it = ids.find(symbol);
+        if (it != ids.end()) return it->second;
+        symbols.push_back(symbol);
+        const int id = static_cast<int>(symbols.size() - 1);
+        ids.emplace(symbols.back(), id);
+        return id;
+    }
+
+    // A deque never moves its strings, so the views keying ids stay valid
+    std::deque<std::string> symbols;
+    std::unordered_map<std::string_view, int> ids;
+    std::unordered_map<uint64_t, std::pair<int, int>> merges; // rank, merged
+};
+
+} // namespace
+
+bool LegacyBPETokenizer::compile_merges(const std::string& merges_path,
+                                        std::vector<char>& image) {
+    CompiledHeader header = {};
+    std::ifstream file(merges_path);
+    if (!file.is_open() ||
+        !source_stamp(merges_path, header.source_size, header.source_mtime)) {
+        std::cerr << "Failed to open BPE model: " << merges_path << std::endl;
+        return false;
     }
 
-    int rank = 1;
+    // Version and comment lines are skipped; ranks follow file order
+    MergesBuilder builder;
+    std::string line, left, right;
+    int rank = 0;
     while (std::getline(file, line)) {
         if (line.empty() || line[0] == '#') continue;
-        std::stringstream ss(line);
-        std::string p1, p2;
-        ss >> p1 >> p2; // Read first two tokens
-        if (!p1.empty() && !p2.empty()) {
-            bpe_ranks[{p1, p2}] = rank++;
+        if (split_merge_line(line, left, right)) {
+            builder.add(left, right, rank++);
         }
     }
+
+    const std::string hash = hash_file_contents(merges_path);
+    std::memcpy(header.source_hash, hash.data(),
+                std::min(hash.size(), sizeof(header.source_hash)));
+    image = builder.build(header);
     return true;
 }
 
-std::vector<std::string> LegacyBPETokenizer::encode(const std::string& text) {
-    std::vector<std::string> bpe_tokens;
-    std::stringstream ss(text);
-    std::string word;
-    
-    while (ss >> word) {
-        // Simple pre-tokenization: just split by space.
-        // TODO: Handle punctuation splitting loop if needed (Arcos usually does this).
-        // For now, assume pure whitespace splitting.
-        
-        std::vector<std::string> word_bpe = apply_bpe(word);
-        
-        // Post-process: </w> -> end of word, others -> @@
-        for (auto& t : word_bpe) {
-            if (t.length() >= 4 && t.substr(t.length() - 4) == "</w>") {
-                t = t.substr(0, t.length() - 4); // Remove </w>
-            } else {
-                t += "@@"; // Append @@
-            }
+bool LegacyBPETokenizer::write_compiled(const std::string& path,
+                                        const std::vector<char>& image) {
+    // Write a file of our own next to the target and rename it, so
+    // processes compiling at the same time never interleave and a loading
+    // tokenizer never maps a half-written table
+    const std::string tmp_path = unique_temp_path(path);
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(image.data(), image.size());
+        if (!out) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) std::filesystem::remove(tmp_path, ec);
+    return !ec;
+}
+
+bool LegacyBPETokenizer::map_compiled(const std::string& path) {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    if (!std::filesystem::exists(path) ||
+        !source_stamp(merges_path, size, mtime) || !compiled_file.Open(path)) {
+        return false;
+    }
+    CompiledHeader header;
+    if (compiled_file.Size() < sizeof(header)) {
+        compiled_file.Close();
+        return false;
+    }
+    std::memcpy(&header, compiled_file.Data(), sizeof(header));
+    if (header.source_size != size || header.source_mtime != mtime ||
+        !use_tables(compiled_file.Data(), compiled_file.Size())) {
+        compiled_file.Close();
+        return false;
+    }
+    return true;
+}
+
+bool LegacyBPETokenizer::use_tables(const char* data, size_t size) {
+    CompiledHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    const size_t index_size = size_t(header.symbol_count) * sizeof(SymbolEntry);
+    const size_t tables_size = sizeof(header) + index_size +
+                               size_t(header.slot_count) *
+                                   sizeof(BpeRankTable::Slot);
+    if (std::memcmp(header.magic, kMergesMagic, sizeof(kMergesMagic)) != 0 ||
+        tables_size > size ||
+        !ranks.Attach(data + sizeof(header) + index_size, header.slot_count)) {
+        return false;
+    }
+    symbol_index = data + sizeof(header);
+    symbol_count = header.symbol_count;
+    blob = data + tables_size;
+    blob_size = size - tables_size;
+    merges_hash.assign(header.source_hash, sizeof(header.source_hash));
+    return true;
+}
+
+int LegacyBPETokenizer::find_symbol(std::string_view symbol) const {
+    uint32_t low = 0;
+    uint32_t high = symbol_count;
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+        SymbolEntry entry;
+        std::memcpy(&entry, symbol_index + size_t(mid) * sizeof(entry),
+                    sizeof(entry));
+        // Offsets are checked as they are read, so loading stays O(1)
+        if (size_t(entry.offset) + entry.length > blob_size) return -1;
+        const int order =
+            std::string_view(blob + entry.offset, entry.length).compare(symbol);
+        if (order == 0) return static_cast<int>(mid);
+        if (order < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
+    }
+    return -1;
+}
+
+bool LegacyBPETokenizer::load(const std::string& model_path) {
+    merges_path = model_path;
+    // Map the compiled table as is; build it when it is missing or older
+    // than the merges file
+    if (!map_compiled(model_path + ".bin")) {
+        if (!compile_merges(model_path, compiled)) return false;
+        // Best effort: packages in read-only directories compile every load
+        write_compiled(model_path + ".bin", compiled);
+        use_tables(compiled.data(), compiled.size());
+    }
+    load_cache();
+    return true;
+}
+
+void LegacyBPETokenizer::encode(std::string_view text, TokenBuffer& tokens) {
+    tokens.clear();
+
+    // Character boundaries of the whole text in one vectorized pass; words
+    // take their characters from here instead of decoding them again
+    thread_local std::vector<uint32_t> chars;
+    chars.clear();
+    const size_t invalid = SplitUtf8(text, chars);
+    if (invalid != std::string::npos) {
+        std::cerr << "[WARN] Invalid UTF-8 at byte " << invalid
+                  << " of BPE input; stray bytes are encoded one by one"
+                  << std::endl;
+    }
+
+    // Words and punctuation split the way the model's training data was
+    thread_local std::vector<std::string_view> words;
+    words.clear();
+    MosesPreTokenize(text, chars, words);
+
+    thread_local std::string word;
+    size_t first = 0; // Index in chars of the current word's first character
+    for (std::string_view span : words) {
+        const size_t start = span.data() - text.data();
+        while (chars[first] < start) ++first;
+        size_t end = first;
+        while (end < chars.size() && chars[end] < start + span.size()) ++end;
+        const size_t word_first = first;
+        first = end;
+        word.assign(span.data(), span.size());
+
+        if (find_cached(word, tokens)) continue;
 
-        bpe_tokens.insert(bpe_tokens.end(), word_bpe.begin(), word_bpe.end());
+        const size_t segments_first = tokens.size();
+        apply_bpe(word, chars.data() + word_first, end - word_first, tokens);
+        if (word.length() <= kMaxCachedWord) {
+            remember(word, tokens, segments_first);
+        }
     }
-    
-    return bpe_tokens;
 }
 
-std::string LegacyBPETokenizer::decode(const std::vector<std::string>& tokens) {
-    std::string text;
-    for (const auto& token : tokens) {
-        if (token.length() >= 2 && token.substr(token.length() - 2) == "@@") {
-            text += token.substr(0, token.length() - 2);
+void LegacyBPETokenizer::decode(const TokenBuffer& tokens, std::string& text) {
+    // "@@" joins a piece to the next one; the rest are Moses tokens
+    thread_local std::string joined;
+    joined.clear();
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const std::string_view piece = tokens.piece(i);
+        if (piece.length() >= 2 && piece.substr(piece.length() - 2) == "@@") {
+            joined.append(piece.data(), piece.length() - 2);
         } else {
-            text += token + " ";
+            joined.append(piece.data(), piece.length());
+            joined += ' ';
         }
     }
     // Trim trailing space
-    if (!text.empty() && text.back() == ' ') text.pop_back();
-    return text;
-}
-
-std::vector<std::string> get_utf8_chars(const std::string& str) {
-    std::vector<std::string> chars;
-    for (size_t i = 0; i < str.length();) {
-        int c = (unsigned char)str[i];
-        int len = 1;
-        if ((c & 0x80) == 0) len = 1;
-        else if ((c & 0xE0) == 0xC0) len = 2;
-        else if ((c & 0xF0) == 0xE0) len = 3;
-        else if ((c & 0xF8) == 0xF0) len = 4;
-        
-        if (i + len > str.length()) len = 1; // Safety fallback
-        chars.push_back(str.substr(i, len));
-        i += len;
-    }
-    return chars;
-}
-
-std::vector<std::string> LegacyBPETokenizer::apply_bpe(const std::string& word) {
-    std::vector<std::string> split_word = get_utf8_chars(word);
-    
-    if (split_word.empty()) return {};
-    split_word.back() += "</w>";
-
-    while (split_word.size() > 1) {
-        // Find best pair
-        int min_rank = -1;
-        std::pair<std::string, std::string> best_pair;
-        int best_idx = -1;
-
-        for (size_t i = 0; i < split_word.size() - 1; ++i) {
-            std::pair<std::string, std::string> pair = {split_word[i], split_word[i+1]};
-            if (bpe_ranks.count(pair)) {
-                int rank = bpe_ranks[pair];
-                if (min_rank == -1 || rank < min_rank) {
-                    min_rank = rank;
-                    best_pair = pair;
-                    best_idx = i;
-                }
-            }
+    if (!joined.empty() && joined.back() == ' ') joined.pop_back();
+    MosesDetokenize(joined, text);
+}
+
+namespace {
+
+// One symbol of the word being merged: a byte range of word + "</w>",
+// linked to its neighbours
+struct BpeNode {
+    int id;
+    int prev;
+    int next;
+    size_t start;
+    size_t end;
+};
+
+// Merging node left with its successor. Stale once either side has merged
+// with something else, which shows as a changed symbol id.
+struct BpeCandidate {
+    int rank;
+    int left;
+    int left_id;
+    int right_id;
+    int merged;
+};
+
+// Heap order: lowest rank first, leftmost first among equal ranks, which
+// merges every occurrence of a pair left to right like a rescan would
+struct CandidateAfter {
+    bool operator()(const BpeCandidate& a, const BpeCandidate& b) const {
+        return a.rank != b.rank ? a.rank > b.rank : a.left > b.left;
+    }
+};
+
+} // namespace
+
+void LegacyBPETokenizer::apply_bpe(const std::string& word,
+                                   const uint32_t* chars, size_t char_count,
+                                   TokenBuffer& tokens) {
+    if (word.empty() || char_count == 0) return;
+
+    // Scratch space reused by every word encoded on this thread
+    thread_local std::string padded;
+    thread_local std::vector<BpeNode> nodes;
+    thread_local std::vector<BpeCandidate> heap;
+    padded.assign(word);
+    padded += "</w>";
+    nodes.clear();
+    heap.clear();
+
+    // Character offsets are relative to the encoded text
+    for (size_t i = 0; i < char_count; ++i) {
+        const int index = static_cast<int>(i);
+        const size_t start = chars[i] - chars[0];
+        const size_t end =
+            i + 1 < char_count ? chars[i + 1] - chars[0] : word.length();
+        nodes.push_back({-1, index - 1, index + 1, start, end});
+    }
+    nodes.back().end = padded.length();
+    nodes.back().next = -1;
+    for (auto& node : nodes) {
+        node.id = find_symbol(
+            std::string_view(padded).substr(node.start, node.end - node.start));
+    }
+
+    auto push_candidate = [&](int left) {
+        const int right = nodes[left].next;
+        if (right < 0 || nodes[left].id < 0 || nodes[right].id < 0) return;
+        BpeMerge merge;
+        if (!ranks.Find(BpeRankTable::PairKey(nodes[left].id, nodes[right].id),
+                        merge)) {
+            return;
         }
+        heap.push_back({merge.rank, left, nodes[left].id, nodes[right].id,
+                        merge.merged});
+        std::push_heap(heap.begin(), heap.end(), CandidateAfter());
+    };
+
+    for (int i = 0; i + 1 < static_cast<int>(nodes.size()); ++i) {
+        push_candidate(i);
+    }
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), CandidateAfter());
+        const BpeCandidate candidate = heap.back();
+        heap.pop_back();
+
+        BpeNode& left = nodes[candidate.left];
+        if (left.id != candidate.left_id || left.next < 0 ||
+            nodes[left.next].id != candidate.right_id) {
+            continue;
+        }
+
+        // The right node is absorbed; the left one now spans both
+        BpeNode& right = nodes[left.next];
+        left.id = candidate.merged;
+        left.end = right.end;
+        left.next = right.next;
+        if (right.next >= 0) nodes[right.next].prev = candidate.left;
+        right.id = -1;
 
-        if (min_rank == -1) break; // No more merges possible
-
-        // Apply merge
-        std::string merged = best_pair.first + best_pair.second;
-        
-        // We need to merge all occurrences? Usually BPE applies one by one or all?
-        // Standard BPE applies the best merge globally or locally? 
-        // "Iteratively, replace the most frequent pair..." 
-        // In local word context, we just replace the first logic or all logic.
-        // Let's create a new vector
-        std::vector<std::string> new_split;
-        for (size_t i = 0; i < split_word.size(); ++i) {
-            if (i < split_word.size() - 1 && 
-                split_word[i] == best_pair.first && 
-                split_word[i+1] == best_pair.second) {
-                new_split.push_back(merged);
-                i++; // Skip next
+        if (left.prev >= 0) push_candidate(left.prev);
+        push_candidate(candidate.left);
+    }
+
+    // </w> marks the end of the word; other segments continue with @@
+    static const std::string_view kEndOfWord = "</w>";
+    thread_local std::string piece;
+    for (int i = 0; i >= 0; i = nodes[i].next) {
+        piece.assign(padded, nodes[i].start, nodes[i].end - nodes[i].start);
+        if (piece.length() >= kEndOfWord.length() &&
+            std::string_view(piece).substr(piece.length() -
+                                           kEndOfWord.length()) == kEndOfWord) {
+            piece.resize(piece.length() - kEndOfWord.length());
+        } else {
+            piece += "@@";
+        }
+        tokens.push_back(nodes[i].id, piece);
+    }
+}
+
+bool LegacyBPETokenizer::find_cached(const std::string& word,
+                                     TokenBuffer& tokens) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = recent_words.find(word);
+    if (it == recent_words.end()) {
+        auto old = older_words.find(word);
+        if (old == older_words.end()) return false;
+        CachedWord segments = std::move(old->second);
+        older_words.erase(old);
+        it = insert_recent(word, std::move(segments));
+    }
+    const std::string_view pieces = it->second.pieces;
+    size_t start = 0;
+    for (int id : it->second.ids) {
+        const size_t end = std::min(pieces.find(' ', start), pieces.size());
+        tokens.push_back(id, pieces.substr(start, end - start));
+        start = end + 1;
+    }
+    return true;
+}
+
+void LegacyBPETokenizer::remember(const std::string& word,
+                                  const TokenBuffer& tokens, size_t first) {
+    CachedWord segments;
+    for (size_t i = first; i < tokens.size(); ++i) {
+        if (i > first) segments.pieces += ' ';
+        segments.ids.push_back(tokens.id(i));
+        const std::string_view piece = tokens.piece(i);
+        segments.pieces.append(piece.data(), piece.size());
+    }
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    insert_recent(word, std::move(segments));
+    cache_dirty = true;
+}
+
+LegacyBPETokenizer::WordCache::iterator
+LegacyBPETokenizer::insert_recent(const std::string& word,
+                                  CachedWord segments) {
+    if (recent_words.size() >= kCacheGeneration) {
+        older_words = std::move(recent_words);
+        recent_words.clear();
+    }
+    return recent_words.emplace(word, std::move(segments)).first;
+}
+
+// One "word<TAB>token token ..." line per word after a "#merges <hash>"
+// header; a cache written for other merges is ignored
+void LegacyBPETokenizer::load_cache() {
+    std::ifstream file(merges_path + ".cache");
+    if (!file.is_open()) return;
+
+    // use_tables took the hash from the compiled header; reading the merges
+    // file is only needed when no table was attached
+    if (merges_hash.empty()) merges_hash = hash_file_contents(merges_path);
+    std::string line;
+    if (!std::getline(file, line) || line != "#merges " + merges_hash) return;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    while (std::getline(file, line) && older_words.size() < kCacheGeneration) {
+        const size_t tab = line.find('\t');
+        if (tab == std::string::npos) continue;
+        // Ids are not stored; they follow from the pieces
+        CachedWord segments;
+        std::stringstream ss(line.substr(tab + 1));
+        std::string token;
+        while (ss >> token) {
+            if (!segments.pieces.empty()) segments.pieces += ' ';
+            segments.pieces += token;
+            if (token.length() >= 2 &&
+                token.compare(token.length() - 2, 2, "@@") == 0) {
+                token.resize(token.length() - 2);
             } else {
-                new_split.push_back(split_word[i]);
+                token += "</w>";
             }
+            segments.ids.push_back(find_symbol(token));
+        }
+        if (!segments.ids.empty()) {
+            older_words.emplace(line.substr(0, tab), std::move(segments));
         }
-        split_word = new_split;
     }
+    std::cerr << "[DEBUG] BPE word cache: " << older_words.size()
+              << " words from " << merges_path << ".cache" << std::endl;
+}
+
+// Best effort: read-only package directories just go without a cache
+void LegacyBPETokenizer::save_cache() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (!cache_dirty || merges_path.empty()) return;
 
-    return split_word;
+    // Write a file of our own then rename it, so processes saving at the
+    // same time never interleave and readers never see a torn cache
+    const std::string cache_path = merges_path + ".cache";
+    const std::string tmp_path = unique_temp_path(cache_path);
+    {
+        std::ofstream file(tmp_path, std::ios::trunc);
+        if (!file.is_open()) return;
+        file << "#merges " << merges_hash << "\n";
+        // Recent words first; the file reloads into a single generation
+        size_t written = 0;
+        for (const auto* words : {&recent_words, &older_words}) {
+            for (const auto& [word, segments] : *words) {
+                if (written++ >= kCacheGeneration) break;
+                file << word << '\t' << segments.pieces << '\n';
+            }
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, cache_path, ec);
+    if (ec) std::filesystem::remove(tmp_path, ec);
+    cache_dirty = false;
 }
@@ -1,6 +1,11 @@
 #pragma once
+#include "bpe_rank_table.h"
+#include "mapped_file.h"
 #include "tokenizer.h"
+#include <cstdint>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
@@ -12,22 +17,76 @@
 // Simple implementation of BPE application
 class LegacyBPETokenizer : public Tokenizer {
 public:
+    ~LegacyBPETokenizer() override;
+
     bool load(const std::string& model_path) override;
-    std::vector<std::string> encode(const std::string& text) override;
-    std::string decode(const std::vector<std::string>& tokens) override;
+    using Tokenizer::encode;
+    using Tokenizer::decode;
+    // Ids are symbol ids of the compiled merges ("low" and "low</w>" differ)
+    void encode(std::string_view text, TokenBuffer& tokens) override;
+    void decode(const TokenBuffer& tokens, std::string& text) override;
+
+    // Compile a merges file into the table load() maps from
+    // <merges file>.bin. load() does this itself when it can write there;
+    // read-only packages can be compiled ahead of time.
+    static bool compile_merges(const std::string& merges_path,
+                               std::vector<char>& image);
+    static bool write_compiled(const std::string& path,
+                               const std::vector<char>& image);
 
 private:
-    struct PairHash {
-        template <class T1, class T2>
-        std::size_t operator()(const std::pair<T1, T2>& p) const {
-            auto h1 = std::hash<T1>{}(p.first);
-            auto h2 = std::hash<T2>{}(p.second);
-            return h1 ^ h2;
-        }
+    bool map_compiled(const std::string& path);
+    bool use_tables(const char* data, size_t size);
+    // -1 for symbols that take part in no merge
+    int find_symbol(std::string_view symbol) const;
+
+    // Compiled merges (host byte order), mapped or built in memory:
+    //   header   magic "FTBPE2", symbol and slot counts, size, mtime and
+    //            hash of the merges file
+    //   symbols  { uint32 offset, length } sorted by text; the position is
+    //            the symbol id
+    //   merges   BpeRankTable slots keyed by (left id, right id)
+    //   string data
+    MappedFile compiled_file;
+    std::vector<char> compiled;
+    const char* symbol_index = nullptr;
+    uint32_t symbol_count = 0;
+    const char* blob = nullptr;
+    size_t blob_size = 0;
+    BpeRankTable ranks;
+
+    // Append the segments of word, with @@ markers, to tokens. chars:
+    // offsets of the word's characters in the text being encoded.
+    void apply_bpe(const std::string& word, const uint32_t* chars,
+                   size_t char_count, TokenBuffer& tokens);
+
+    // Segments of a word as encode emits them; pieces are separated by
+    // spaces, which never occur inside a word
+    struct CachedWord {
+        std::vector<int> ids;
+        std::string pieces;
     };
+    using WordCache = std::unordered_map<std::string, CachedWord>;
+
+    // Append the cached segmentation of word to tokens, if there is one
+    bool find_cached(const std::string& word, TokenBuffer& tokens);
+    // Cache the tokens from index first on as the segments of word
+    void remember(const std::string& word, const TokenBuffer& tokens,
+                  size_t first);
+    // Caller holds cache_mutex
+    WordCache::iterator insert_recent(const std::string& word,
+                                      CachedWord segments);
+    void load_cache();
+    void save_cache();
 
-    std::unordered_map<std::pair<std::string, std::string>, int, PairHash> bpe_ranks;
-    
-    std::vector<std::string> get_vocabulary(const std::string& word);
-    std::vector<std::string> apply_bpe(const std::string& word);
+    // Segmentations (with @@ markers) of recently encoded words. Two
+    // generations make a cheap LRU: a hit in the older one moves the word
+    // to the recent one, and a full recent generation replaces the older.
+    std::mutex cache_mutex;
+    WordCache recent_words;
+    WordCache older_words;
+    bool cache_dirty = false;
+    // Persisted as <merges file>.cache, tagged with the merges hash
+    std::string merges_path;
+    std::string merges_hash;
 };
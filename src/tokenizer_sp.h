@@ -1,6 +1,7 @@
 #pragma once
 #include "tokenizer.h"
 #include <sentencepiece_processor.h>
+#include <algorithm>
 #include <memory>
 #include <iostream>
 
@@ -16,20 +17,44 @@ public:
         return true;
     }
 
-    std::vector<std::string> encode(const std::string& text) override {
-        std::vector<std::string> tokens;
-        if (processor) {
-            processor->Encode(text, &tokens);
+    using Tokenizer::encode;
+    using Tokenizer::decode;
+
+    // Pieces are views of the model's vocabulary until they are copied
+    // into the buffer; no per-token strings are built
+    void encode(std::string_view text, TokenBuffer& tokens) override {
+        tokens.clear();
+        if (!processor) return;
+        thread_local std::vector<int> ids;
+        ids.clear();
+        processor->Encode(text, &ids);
+        for (int id : ids) {
+            tokens.push_back(id, processor->IdToPiece(id));
         }
-        return tokens;
     }
 
-    std::string decode(const std::vector<std::string>& tokens) override {
-        std::string text;
-        if (processor) {
-            processor->Decode(tokens, &text);
+    // Tokens without ids (e.g. CTranslate2 output) are decoded as pieces,
+    // like SentencePiece's own piece API does, so pieces outside the
+    // vocabulary keep their text instead of becoming the unknown symbol
+    void decode(const TokenBuffer& tokens, std::string& text) override {
+        if (!processor) return;
+        thread_local std::string decoded;
+        const auto& ids = tokens.ids();
+        const bool have_ids = std::all_of(ids.begin(), ids.end(),
+                                          [](int id) { return id >= 0; });
+        if (have_ids) {
+            processor->Decode(ids, &decoded);
+        } else {
+            // Strings are reused from call to call, keeping their capacity
+            thread_local std::vector<std::string> pieces;
+            pieces.resize(tokens.size());
+            for (size_t i = 0; i < tokens.size(); ++i) {
+                const std::string_view piece = tokens.piece(i);
+                pieces[i].assign(piece.data(), piece.size());
+            }
+            processor->Decode(pieces, &decoded);
         }
-        return text;
+        text += decoded;
     }
 
 private:
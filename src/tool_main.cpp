@@ -0,0 +1,423 @@
+// Offline maintenance commands for installed packages
+#include "model_quantizer.h"
+#include "package_installer.h"
+#include "tokenizer.h"
+#include "tokenizer_bpe.h"
+#include "translation.h"
+#include "translation_memory.h"
+#include "utils.h"
+#include "word_dictionary.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+static std::string find_tokenizer_model(const std::string &package_dir) {
+  std::string model = package_dir + "/sentencepiece.model";
+  if (!std::filesystem::exists(model)) {
+    model = package_dir + "/bpe.model";
+  }
+  return model;
+}
+
+// Build a CTranslate2 vocabulary map (vmap.txt) from a parallel corpus.
+// For every source token the targets that co-occur with it most often are
+// kept; the most frequent target tokens overall are always allowed.
+static int build_vmap(int argc, char *argv[]) {
+  if (argc < 5) {
+    std::cerr << "Usage: fast-translator-tool build-vmap <package_dir> "
+                 "<corpus.src> <corpus.tgt> [--per-token N] [--always N]"
+              << std::endl;
+    return 1;
+  }
+
+  const std::string package_dir = argv[2];
+  const std::string source_path = argv[3];
+  const std::string target_path = argv[4];
+  size_t per_token = 20;
+  size_t always = 100;
+  for (int i = 5; i < argc - 1; i++) {
+    std::string arg = argv[i];
+    if (arg == "--per-token") {
+      per_token = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--always") {
+      always = std::max(0, std::atoi(argv[++i]));
+    }
+  }
+
+  // Argos packages use the same tokenizer model for both sides
+  std::string tokenizer_model = find_tokenizer_model(package_dir);
+  auto tokenizer = CreateTokenizer(tokenizer_model);
+  if (!tokenizer->load(tokenizer_model)) {
+    std::cerr << "Failed to load tokenizer: " << tokenizer_model << std::endl;
+    return 1;
+  }
+
+  std::ifstream source_file(source_path);
+  std::ifstream target_file(target_path);
+  if (!source_file.is_open() || !target_file.is_open()) {
+    std::cerr << "Failed to open corpus files" << std::endl;
+    return 1;
+  }
+
+  std::unordered_map<std::string, std::unordered_map<std::string, uint32_t>>
+      cooccurrence;
+  std::unordered_map<std::string, uint64_t> target_frequency;
+
+  std::string source_line, target_line;
+  size_t lines = 0;
+  while (std::getline(source_file, source_line) &&
+         std::getline(target_file, target_line)) {
+    std::vector<std::string> source_tokens = tokenizer->encode(source_line);
+    std::vector<std::string> target_tokens = tokenizer->encode(target_line);
+
+    // Count each token once per sentence pair
+    std::sort(source_tokens.begin(), source_tokens.end());
+    source_tokens.erase(
+        std::unique(source_tokens.begin(), source_tokens.end()),
+        source_tokens.end());
+    std::sort(target_tokens.begin(), target_tokens.end());
+    target_tokens.erase(
+        std::unique(target_tokens.begin(), target_tokens.end()),
+        target_tokens.end());
+
+    for (const auto &target : target_tokens) {
+      target_frequency[target]++;
+    }
+    for (const auto &source : source_tokens) {
+      auto &row = cooccurrence[source];
+      for (const auto &target : target_tokens) {
+        row[target]++;
+      }
+    }
+
+    if (++lines % 100000 == 0) {
+      std::cerr << "[Info] " << lines << " sentence pairs" << std::endl;
+    }
+  }
+
+  if (lines == 0) {
+    std::cerr << "Corpus is empty" << std::endl;
+    return 1;
+  }
+
+  using Entry = std::pair<std::string, uint64_t>;
+  auto by_count = [](const Entry &a, const Entry &b) {
+    return a.second > b.second || (a.second == b.second && a.first < b.first);
+  };
+
+  std::vector<Entry> frequent(target_frequency.begin(),
+                              target_frequency.end());
+  std::sort(frequent.begin(), frequent.end(), by_count);
+  frequent.resize(std::min(always, frequent.size()));
+  std::unordered_set<std::string> always_allowed;
+  for (const auto &entry : frequent) {
+    always_allowed.insert(entry.first);
+  }
+
+  const std::string vmap_path = package_dir + "/vmap.txt";
+  std::ofstream out(vmap_path);
+  if (!out.is_open()) {
+    std::cerr << "Failed to write " << vmap_path << std::endl;
+    return 1;
+  }
+
+  // An empty source key lists targets allowed for every input
+  out << '\t';
+  for (size_t i = 0; i < frequent.size(); i++) {
+    out << (i ? " " : "") << frequent[i].first;
+  }
+  out << '\n';
+
+  for (const auto &[source, row] : cooccurrence) {
+    std::vector<Entry> candidates;
+    for (const auto &[target, count] : row) {
+      if (!always_allowed.count(target)) {
+        candidates.emplace_back(target, count);
+      }
+    }
+    if (candidates.empty())
+      continue;
+
+    const size_t keep = std::min(per_token, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + keep,
+                      candidates.end(), by_count);
+
+    out << source << '\t';
+    for (size_t i = 0; i < keep; i++) {
+      out << (i ? " " : "") << candidates[i].first;
+    }
+    out << '\n';
+  }
+
+  std::cout << "Wrote " << vmap_path << " (" << cooccurrence.size()
+            << " source tokens from " << lines << " sentence pairs)"
+            << std::endl;
+  return 0;
+}
+
+// Build a single-word dictionary (dictionary.bin) by running the package's
+// model over a word list, most frequent words first. The hotkey answers
+// single words from it without loading the model. Entries hold the model's
+// own output, so a dictionary hit pastes what the model would have.
+static int build_dict(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cerr << "Usage: fast-translator-tool build-dict <package_dir> "
+                 "<word_list> [--limit N] [--batch N]"
+              << std::endl;
+    return 1;
+  }
+
+  const std::string package_dir = argv[2];
+  const std::string word_list_path = argv[3];
+  size_t limit = 50000;
+  size_t batch_size = 64;
+  for (int i = 4; i < argc - 1; i++) {
+    std::string arg = argv[i];
+    if (arg == "--limit") {
+      limit = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--batch") {
+      batch_size = std::max(1, std::atoi(argv[++i]));
+    }
+  }
+
+  // Frequency lists ("word count" per line) and plain word lists both work:
+  // only the first field is used
+  std::ifstream word_list(word_list_path);
+  if (!word_list.is_open()) {
+    std::cerr << "Failed to open word list: " << word_list_path << std::endl;
+    return 1;
+  }
+  std::vector<std::string> words;
+  std::unordered_set<std::string> seen;
+  std::string line;
+  while (words.size() < limit && std::getline(word_list, line)) {
+    std::stringstream ss(line);
+    std::string word;
+    if (ss >> word && seen.insert(word).second) {
+      words.push_back(word);
+    }
+  }
+
+  ArgosTranslator translator;
+  translator.set_workload(Workload{2, batch_size});
+  if (!translator.load_model(package_dir + "/model",
+                             find_tokenizer_model(package_dir))) {
+    return 1;
+  }
+
+  std::vector<std::pair<std::string, std::string>> entries;
+  entries.reserve(words.size());
+  for (size_t start = 0; start < words.size(); start += batch_size) {
+    const size_t end = std::min(words.size(), start + batch_size);
+    std::vector<std::string> batch(words.begin() + start,
+                                   words.begin() + end);
+    const auto outputs = translator.translate_batch(batch);
+    for (size_t i = 0; i < batch.size() && i < outputs.size(); i++) {
+      std::string translation = clean_translation_output(outputs[i]);
+      if (!translation.empty()) {
+        entries.emplace_back(batch[i], std::move(translation));
+      }
+    }
+    std::cerr << "\rTranslated " << end << "/" << words.size() << std::flush;
+  }
+  std::cerr << std::endl;
+
+  const std::string dictionary_path = GetDictionaryPath(package_dir);
+  if (!WordDictionary::Write(dictionary_path, std::move(entries))) {
+    std::cerr << "Failed to write " << dictionary_path << std::endl;
+    return 1;
+  }
+
+  std::cout << "Wrote " << dictionary_path << " (" << words.size()
+            << " words)" << std::endl;
+  return 0;
+}
+
+// Install an .argosmodel archive (local file or URL) without the GUI.
+// The model is quantized to int8 unless --keep-float is given.
+static int install_package(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cerr << "Usage: fast-translator-tool install <file.argosmodel|url> "
+                 "<packages_dir> [--keep-float]"
+              << std::endl;
+    return 1;
+  }
+
+  std::string archive = argv[2];
+  const std::string packages_dir = argv[3];
+  bool quantize = true;
+  for (int i = 4; i < argc; i++) {
+    if (std::string(argv[i]) == "--keep-float") {
+      quantize = false;
+    }
+  }
+
+  const bool remote = archive.rfind("http://", 0) == 0 ||
+                      archive.rfind("https://", 0) == 0;
+  if (remote) {
+    std::filesystem::create_directories(packages_dir);
+    const std::string download = packages_dir + "/temp_pkg.zip";
+    std::string error;
+    if (!DownloadPackageArchive(archive, download, error)) {
+      std::cerr << error << std::endl;
+      return 1;
+    }
+    archive = download;
+  }
+
+  std::string package_name, error;
+  bool installed = InstallPackageArchive(archive, packages_dir, quantize,
+                                         package_name, error);
+  if (remote) {
+    std::filesystem::remove(archive);
+  }
+  if (!installed) {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  std::cout << "Installed " << package_name << std::endl;
+  return 0;
+}
+
+// Quantize an already installed package in place
+static int quantize_package(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: fast-translator-tool quantize <package_dir>"
+              << std::endl;
+    return 1;
+  }
+
+  QuantizeStats stats;
+  if (!QuantizeModelToInt8(std::string(argv[2]) + "/model", &stats)) {
+    return 1;
+  }
+  if (stats.quantized_variables == 0) {
+    std::cout << "Model is already quantized" << std::endl;
+  } else {
+    std::cout << "Quantized " << stats.quantized_variables << " weights: "
+              << stats.bytes_before / (1024 * 1024) << " MB -> "
+              << stats.bytes_after / (1024 * 1024) << " MB" << std::endl;
+  }
+  return 0;
+}
+
+// Compile a legacy BPE package's merges into bpe.model.bin, which the
+// tokenizer maps instead of parsing the merges at every load. Needed only
+// where the translator cannot write into the package directory.
+static int compile_bpe(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: fast-translator-tool compile-bpe <package_dir>"
+              << std::endl;
+    return 1;
+  }
+  const std::string merges = std::string(argv[2]) + "/bpe.model";
+  if (!std::filesystem::exists(merges)) {
+    std::cerr << "No bpe.model in " << argv[2]
+              << " (SentencePiece packages need no compiling)" << std::endl;
+    return 1;
+  }
+
+  std::vector<char> image;
+  if (!LegacyBPETokenizer::compile_merges(merges, image)) {
+    return 1;
+  }
+  if (!LegacyBPETokenizer::write_compiled(merges + ".bin", image)) {
+    std::cerr << "Failed to write " << merges << ".bin" << std::endl;
+    return 1;
+  }
+  std::cout << "Wrote " << merges << ".bin (" << image.size() / 1024
+            << " KB)" << std::endl;
+  return 0;
+}
+
+// Merge approved translations (TMX or TSV) into the memory of a language
+// pair, which translation checks before running the model
+static int import_memory(int argc, char *argv[]) {
+  const std::string pair = argc >= 4 ? argv[3] : "";
+  const size_t colon = pair.find(':');
+  if (argc < 4 || colon == std::string::npos) {
+    std::cerr << "Usage: fast-translator-tool import-tm <file.tmx|file.tsv> "
+                 "<from:to>"
+              << std::endl;
+    return 1;
+  }
+  const std::string input = argv[2];
+  const std::string from = pair.substr(0, colon);
+  const std::string to = pair.substr(colon + 1);
+
+  std::string extension = std::filesystem::path(input).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  SegmentPairs pairs;
+  const bool read = extension == ".tmx" ? ReadTmx(input, from, to, pairs)
+                                        : ReadTsv(input, pairs);
+  if (!read) {
+    return 1;
+  }
+  if (pairs.empty()) {
+    std::cerr << "No " << from << "->" << to << " segments found in " << input
+              << std::endl;
+    return 1;
+  }
+
+  const std::string path = TranslationMemory::GetPath(from, to);
+  size_t total = 0;
+  if (!TranslationMemory::Import(path, pairs, total)) {
+    return 1;
+  }
+  std::cout << "Imported " << pairs.size() << " segments into " << path
+            << " (" << total << " total)" << std::endl;
+  return 0;
+}
+
+static void print_usage() {
+  std::cerr << "Usage: fast-translator-tool <command> [args]\n"
+            << "Commands:\n"
+            << "  build-vmap <package_dir> <corpus.src> <corpus.tgt>\n"
+            << "             [--per-token N] [--always N]\n"
+            << "  build-dict <package_dir> <word_list> [--limit N]"
+            << " [--batch N]\n"
+            << "  install <file.argosmodel|url> <packages_dir> [--keep-float]\n"
+            << "  quantize <package_dir>\n"
+            << "  compile-bpe <package_dir>\n"
+            << "  import-tm <file.tmx|file.tsv> <from:to>" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    print_usage();
+    return 1;
+  }
+
+  std::string command = argv[1];
+  if (command == "build-vmap") {
+    return build_vmap(argc, argv);
+  }
+  if (command == "build-dict") {
+    return build_dict(argc, argv);
+  }
+  if (command == "install") {
+    return install_package(argc, argv);
+  }
+  if (command == "quantize") {
+    return quantize_package(argc, argv);
+  }
+  if (command == "compile-bpe") {
+    return compile_bpe(argc, argv);
+  }
+  if (command == "import-tm") {
+    return import_memory(argc, argv);
+  }
+
+  print_usage();
+  return 1;
+}
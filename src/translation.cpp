@@ -1,18 +1,65 @@
 #include "translation.h"
+#include "thread_planner.h"
+#include "token_chunker.h"
 #include "tokenizer.h"
-#include "tokenizer_bpe.h"
-#include "tokenizer_sp.h"
+#include "utils.h"
 #include <algorithm>
 #include <ctranslate2/devices.h>
+#include <ctranslate2/models/model_reader.h>
 #include <ctranslate2/translator.h>
-#include <thread>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
 
 struct ArgosTranslator::Impl {
   std::unique_ptr<Tokenizer> tokenizer;
   std::unique_ptr<ctranslate2::Translator> translator;
   ctranslate2::Device device_used;
+  bool use_vmap = false;
+  std::string tokenizer_hash;
+  // Off by default: cutting changes translations. Argos models are trained
+  // on sentences, so very long inputs may want --chunk-tokens.
+  size_t max_chunk_tokens = 0;
+  Workload workload;
 };
 
+// Reads model files from the model directory, except the vocabulary map
+// which Argos packages may ship next to the model directory. model.bin is
+// read as a plain stream: CTranslate2 copies every weight into storage it
+// owns (and may repack it for the device), so weights cannot be served from
+// a shared mapping and each process holds its own copy.
+class PackageModelReader : public ctranslate2::models::ModelFileReader {
+public:
+  PackageModelReader(const std::string &model_dir, std::string vmap_path)
+      : ctranslate2::models::ModelFileReader(model_dir),
+        vmap_path(std::move(vmap_path)) {}
+
+  std::unique_ptr<std::istream> get_file(const std::string &filename,
+                                         const bool binary) override {
+    if (filename == "vmap.txt" && !vmap_path.empty()) {
+      return std::make_unique<std::ifstream>(vmap_path);
+    }
+    return ctranslate2::models::ModelFileReader::get_file(filename, binary);
+  }
+
+private:
+  std::string vmap_path;
+};
+
+// Locate an optional vocabulary map: inside the model directory (read by
+// CTranslate2 itself) or in the package directory above it
+static std::string find_vmap(const std::string &model_path) {
+  std::filesystem::path model_dir(model_path);
+  for (const auto &candidate :
+       {model_dir / "vmap.txt", model_dir.parent_path() / "vmap.txt"}) {
+    if (std::filesystem::exists(candidate)) {
+      return candidate.string();
+    }
+  }
+  return "";
+}
+
 ArgosTranslator::ArgosTranslator() : impl(std::make_unique<Impl>()) {}
 ArgosTranslator::~ArgosTranslator() = default;
 
@@ -34,42 +81,33 @@ static ctranslate2::Device get_best_device() {
   return ctranslate2::Device::CPU;
 }
 
-// Calculate optimal thread count: use ~75% of available cores, minimum 1
-static size_t get_optimal_threads() {
-  unsigned int hw_threads = std::thread::hardware_concurrency();
-  if (hw_threads == 0)
-    hw_threads = 4; // Fallback if detection fails
-
-  // Use 75% of cores, but at least 1 and leave at least 1 for system
-  size_t optimal = std::max(1u, static_cast<unsigned int>(hw_threads * 0.75));
-  return std::min(optimal, static_cast<size_t>(hw_threads - 1));
-}
-
 bool ArgosTranslator::load_model(const std::string &model_path,
                                  const std::string &bpe_source_model) {
-  if (bpe_source_model.find("sentencepiece.model") != std::string::npos) {
-    impl->tokenizer = std::make_unique<SentencePieceTokenizer>();
-  } else {
-    // Assume legacy BPE if not sentencepiece
-    impl->tokenizer = std::make_unique<LegacyBPETokenizer>();
-  }
+  impl->tokenizer = CreateTokenizer(bpe_source_model);
 
   if (!impl->tokenizer->load(bpe_source_model)) {
     std::cerr << "Failed to load tokenizer: " << bpe_source_model << std::endl;
     return false;
   }
+  impl->tokenizer_hash = hash_file_contents(bpe_source_model);
 
   try {
     // Detect best available device
     ctranslate2::Device device = get_best_device();
     impl->device_used = device;
 
-    // Calculate safe thread count (75% of cores) - only used for CPU
-    size_t num_threads = get_optimal_threads();
+    // Size the thread pool to the expected input - only used for CPU
+    size_t num_threads = PlanThreads(impl->workload, GetAvailableCpus());
+
+    // Vocabulary shortlisting restricts the output softmax to likely target
+    // tokens, which speeds up every decoding step
+    std::string vmap_path = find_vmap(model_path);
+    impl->use_vmap = !vmap_path.empty();
+    PackageModelReader model_reader(model_path, vmap_path);
 
     // Create translator with automatic device selection
     impl->translator = std::make_unique<ctranslate2::Translator>(
-        model_path, device, ctranslate2::ComputeType::DEFAULT,
+        model_reader, device, ctranslate2::ComputeType::DEFAULT,
         std::vector<int>{0}, // device_indices
         false,               // tensor_parallel
         ctranslate2::ReplicaPoolConfig{
@@ -77,6 +115,11 @@ bool ArgosTranslator::load_model(const std::string &model_path,
             /* max_queued_batches */ 0,
             /* cpu_core_offset */ -1});
 
+    if (impl->use_vmap) {
+      std::cerr << "[Info] Vocabulary shortlist enabled: " << vmap_path
+                << std::endl;
+    }
+
     if (device == ctranslate2::Device::CUDA) {
       std::cerr << "[Info] Model loaded on GPU" << std::endl;
     } else {
@@ -96,24 +139,142 @@ std::string ArgosTranslator::translate(const std::string &text) {
     return "Error: Models not loaded.";
   }
 
+  // Tokenized straight into the batch, without copying text into a vector
+  std::vector<std::vector<std::string>> batch;
+  batch.push_back(impl->tokenizer->encode(text));
+  auto outputs = translate_tokenized(batch);
+  if (outputs.empty())
+    return "";
+  return std::move(outputs[0]);
+}
+
+std::vector<std::string>
+ArgosTranslator::translate_batch(const std::vector<std::string> &texts) {
+  if (!impl->tokenizer || !impl->translator || texts.empty()) {
+    return {};
+  }
+
   // 1. Tokenize
-  std::vector<std::string> tokens = impl->tokenizer->encode(text);
+  std::vector<std::vector<std::string>> batch;
+  batch.reserve(texts.size());
+  for (const auto &text : texts) {
+    batch.push_back(impl->tokenizer->encode(text));
+  }
+
+  // 2. Translate and detokenize
+  return translate_tokenized(batch);
+}
+
+std::vector<std::string> ArgosTranslator::encode(const std::string &text) {
+  if (!impl->tokenizer) {
+    return {};
+  }
+  return impl->tokenizer->encode(text);
+}
+
+std::vector<std::string> ArgosTranslator::translate_tokenized(
+    const std::vector<std::vector<std::string>> &batch) {
+  const auto results = translate_tokens(batch);
+
+  // Detokenize
+  std::vector<std::string> outputs;
+  outputs.reserve(results.size());
+  for (const auto &tokens : results) {
+    outputs.push_back(decode(tokens));
+  }
+  return outputs;
+}
+
+std::vector<std::vector<std::string>> ArgosTranslator::translate_tokens(
+    const std::vector<std::vector<std::string>> &batch,
+    const std::vector<const CancellationToken *> &cancel) {
+  if (!impl->tokenizer || !impl->translator || batch.empty()) {
+    return {};
+  }
+
+  auto is_cancelled = [&cancel](size_t input) {
+    return input < cancel.size() && cancel[input] &&
+           cancel[input]->IsCancelled();
+  };
+  bool all_cancelled = !cancel.empty();
+  for (size_t i = 0; i < batch.size() && all_cancelled; i++) {
+    all_cancelled = is_cancelled(i);
+  }
+  if (all_cancelled) {
+    return std::vector<std::vector<std::string>>(batch.size());
+  }
 
-  // 2. Translate
   ctranslate2::TranslationOptions options;
   // Simple greedy search
   options.beam_size = 1;
+  options.use_vmap = impl->use_vmap;
 
-  // Batch size 1
-  const std::vector<std::vector<std::string>> batch = {tokens};
-  const auto results = impl->translator->translate_batch(batch, options);
+  // Cut long inputs into chunks that are decoded side by side in the batch
+  std::vector<size_t> owner; // chunk -> input index
+  std::vector<TokenRange> ranges;
+  for (size_t i = 0; i < batch.size(); i++) {
+    for (const auto &range : ChunkTokens(batch[i], impl->max_chunk_tokens)) {
+      owner.push_back(i);
+      ranges.push_back(range);
+    }
+  }
+
+  // The step callback (greedy search only) stops each input on its own, so
+  // one caller giving up does not cut short the rest of the batch
+  if (!cancel.empty()) {
+    options.callback = [&owner, &is_cancelled](
+                           ctranslate2::GenerationStepResult step) {
+      return step.batch_id < owner.size() && is_cancelled(owner[step.batch_id]);
+    };
+  }
 
-  if (results.empty())
+  const bool chunked = ranges.size() > batch.size();
+  std::vector<std::vector<std::string>> chunks;
+  if (chunked) {
+    chunks.reserve(ranges.size());
+    for (size_t c = 0; c < ranges.size(); c++) {
+      const auto &tokens = batch[owner[c]];
+      chunks.emplace_back(tokens.begin() + ranges[c].first,
+                          tokens.begin() + ranges[c].second);
+    }
+  }
+
+  auto results =
+      impl->translator->translate_batch(chunked ? chunks : batch, options);
+
+  // Stitch chunk outputs back together in order, moving the tokens out of
+  // the results
+  std::vector<std::vector<std::string>> outputs(batch.size());
+  for (size_t c = 0; c < owner.size() && c < results.size(); c++) {
+    if (!results[c].hypotheses.empty()) {
+      auto &tokens = results[c].hypotheses[0];
+      auto &output = outputs[owner[c]];
+      if (output.empty()) {
+        output = std::move(tokens);
+      } else {
+        output.insert(output.end(), std::make_move_iterator(tokens.begin()),
+                      std::make_move_iterator(tokens.end()));
+      }
+    }
+  }
+  return outputs;
+}
+
+std::string ArgosTranslator::decode(const std::vector<std::string> &tokens) {
+  if (!impl->tokenizer) {
     return "";
+  }
+  return impl->tokenizer->decode(tokens);
+}
 
-  const auto &target_tokens = results[0].output();
+const std::string &ArgosTranslator::tokenizer_hash() const {
+  return impl->tokenizer_hash;
+}
+
+void ArgosTranslator::set_max_chunk_tokens(size_t max_tokens) {
+  impl->max_chunk_tokens = max_tokens;
+}
 
-  // 3. Detokenize
-  std::string output = impl->tokenizer->decode(target_tokens);
-  return output;
+void ArgosTranslator::set_workload(const Workload &workload) {
+  impl->workload = workload;
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include "translation_model.h"
 #include <string>
 #include <vector>
 #include <memory>
@@ -9,14 +10,45 @@
 // For now, simple include is fine if headers are available. 
 // If not, we might hide them behind cpp.
 
-class ArgosTranslator {
+class ArgosTranslator : public TranslationModel {
 public:
     ArgosTranslator();
     ~ArgosTranslator();
 
-    bool load_model(const std::string& model_path, const std::string& sp_model_path);
+    // Expected input size, used to pick the CPU thread count when the model
+    // is loaded (CTranslate2 fixes its thread pool at construction)
+    void set_workload(const Workload& workload) override;
+
+    bool load_model(const std::string& model_path, const std::string& sp_model_path) override;
     std::string translate(const std::string& text);
 
+    // Translate several independent segments in a single CTranslate2 batch.
+    // Results are returned in input order.
+    std::vector<std::string> translate_batch(const std::vector<std::string>& texts);
+
+    // Lower-level steps of translate_batch, used by callers that tokenize
+    // ahead of time (e.g. the batch scheduler measuring token budgets).
+    std::vector<std::string> encode(const std::string& text) override;
+    std::vector<std::string> translate_tokenized(
+        const std::vector<std::vector<std::string>>& batch);
+
+    // Raw target tokens, without detokenization. cancel holds an optional
+    // token per input (or is empty); a cancelled input stops decoding at the
+    // next step and keeps the tokens generated so far.
+    std::vector<std::vector<std::string>> translate_tokens(
+        const std::vector<std::vector<std::string>>& batch,
+        const std::vector<const CancellationToken*>& cancel = {}) override;
+    std::string decode(const std::vector<std::string>& tokens) override;
+
+    // Content hash of the tokenizer model; packages with equal hashes
+    // tokenize identically and can exchange token sequences directly.
+    const std::string& tokenizer_hash() const override;
+
+    // Inputs longer than this many tokens are cut at sentence or clause
+    // boundaries, translated as one batch and stitched back together.
+    // 0 disables chunking.
+    void set_max_chunk_tokens(size_t max_tokens) override;
+
 private:
     struct Impl;
     std::unique_ptr<Impl> impl;
@@ -0,0 +1,45 @@
+#include "translation_backend.h"
+#include "translation_chain.h"
+#include <iostream>
+
+TranslationBackend::TranslationBackend(std::string packages_dir,
+                                       std::vector<std::string> route,
+                                       std::chrono::milliseconds decode_timeout,
+                                       MarkupFormat format)
+    : packagesDir(std::move(packages_dir)), route(std::move(route)),
+      decodeTimeout(decode_timeout), format(format) {}
+
+BackendResult TranslationBackend::Run(const std::string &input,
+                                      const CancellationTokenPtr &cancel,
+                                      const ChunkCallback &on_chunk) {
+  BackendResult result;
+
+  TranslationChain chain;
+  if (!chain.Load(packagesDir, route)) {
+    result.error = chain.GetError();
+    return result;
+  }
+
+  if (cancel && decodeTimeout.count() > 0) {
+    cancel->SetDeadline(decodeTimeout);
+  }
+
+  std::cerr << "[DEBUG] Models loaded. Translating..." << std::endl;
+  result.output = format == MarkupFormat::Plain
+                      ? chain.Translate(input, cancel)
+                      : TranslateMarkup(input, format, chain, cancel);
+
+  if (chain.WasCancelled()) {
+    // Decoding stopped in the last hop: a truncated translation beats none
+    result.partial = !result.output.empty();
+    result.ok = result.partial;
+    result.error = chain.GetError();
+  } else {
+    result.ok = chain.GetError().empty();
+    result.error = chain.GetError();
+  }
+  if (on_chunk && !result.output.empty()) {
+    on_chunk(result.output);
+  }
+  return result;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "backend.h"
+#include "markup_translator.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Translates text along a route of Argos packages (CTranslate2). Models come
+// from the ModelCache, so jobs on the same route share them.
+class TranslationBackend : public Backend {
+public:
+  // decode_timeout, when non-zero, is set as the deadline of the job's
+  // cancel token once the models are loaded: loading is bounded by model
+  // size, decoding by input length. With a Markdown or HTML format only the
+  // text between the markup is translated.
+  TranslationBackend(std::string packages_dir, std::vector<std::string> route,
+                     std::chrono::milliseconds decode_timeout =
+                         std::chrono::milliseconds(0),
+                     MarkupFormat format = MarkupFormat::Plain);
+
+  std::string Kind() const override { return "ct2"; }
+
+  // The whole translation is emitted as a single chunk
+  BackendResult Run(const std::string &input,
+                    const CancellationTokenPtr &cancel,
+                    const ChunkCallback &on_chunk) override;
+
+private:
+  std::string packagesDir;
+  std::vector<std::string> route;
+  std::chrono::milliseconds decodeTimeout;
+  MarkupFormat format;
+};
@@ -0,0 +1,250 @@
+#include "translation_chain.h"
+#include "language_graph.h"
+#include "model_cache.h"
+#include "translation_memory.h"
+#include "utils.h"
+#include <filesystem>
+#include <iostream>
+#include <unordered_map>
+
+PackageFiles ResolvePackageFiles(const std::string &packages_dir,
+                                 const std::string &pkg_name) {
+  PackageFiles files;
+  files.name = pkg_name;
+  files.dir = packages_dir + "/" + pkg_name;
+  files.model_dir = files.dir + "/model";
+  files.tokenizer_model = files.dir + "/sentencepiece.model";
+
+  // Try .bpe.model as fallback
+  if (!std::filesystem::exists(files.tokenizer_model)) {
+    files.tokenizer_model = files.dir + "/bpe.model";
+  }
+  return files;
+}
+
+bool TranslationChain::Load(const std::string &packages_dir,
+                            const std::vector<std::string> &route) {
+  hops.clear();
+  error.clear();
+
+  if (route.size() < 2) {
+    error = "Route needs at least a source and a target language";
+    return false;
+  }
+
+  LanguageGraph graph;
+  graph.BuildFromPackages(packages_dir);
+
+  for (size_t i = 0; i + 1 < route.size(); i++) {
+    Hop hop;
+    hop.from = route[i];
+    hop.to = route[i + 1];
+
+    std::cout << "Hop " << (i + 1) << ": " << hop.from << " -> " << hop.to
+              << std::endl;
+
+    std::string pkg_name = graph.GetPackagePath(hop.from, hop.to);
+    std::cerr << "[DEBUG] Hop " << (i + 1) << " package: " << pkg_name
+              << std::endl;
+
+    if (pkg_name.empty()) {
+      error = "Missing translation package";
+      std::cerr << "Error: No package for " << hop.from << "->" << hop.to
+                << std::endl;
+      return false;
+    }
+
+    hop.package = ResolvePackageFiles(packages_dir, pkg_name);
+
+    std::cout << "  Loading: " << pkg_name << std::endl;
+    std::cerr << "[DEBUG] Loading model from: " << hop.package.model_dir
+              << std::endl;
+
+    hop.scheduler = ModelCache::GetInstance().Acquire(hop.package);
+    if (!hop.scheduler) {
+      error = "Failed to load model: " + pkg_name;
+      std::cerr << "[ERROR] " << error << std::endl;
+      return false;
+    }
+
+    // Approved translations for the pair are used instead of the model
+    auto memory = std::make_shared<TranslationMemory>();
+    if (memory->Open(TranslationMemory::GetPath(hop.from, hop.to))) {
+      std::cerr << "[DEBUG] Translation memory " << hop.from << "->"
+                << hop.to << ": " << memory->Size() << " segments"
+                << std::endl;
+      hop.memory = std::move(memory);
+    }
+
+    hops.push_back(std::move(hop));
+  }
+
+  return true;
+}
+
+std::string TranslationChain::GetRouteId() const {
+  std::string id;
+  for (const auto &hop : hops) {
+    if (!id.empty()) {
+      id += ' ';
+    }
+    id += hop.from + ">" + hop.to + ":" + hop.package.name;
+  }
+  return id;
+}
+
+std::string TranslationChain::Translate(const std::string &text,
+                                        CancellationTokenPtr cancel) {
+  const auto outputs = TranslateBatch({text}, std::move(cancel));
+  return outputs.empty() ? "" : outputs[0];
+}
+
+std::vector<std::string>
+TranslationChain::TranslateBatch(const std::vector<std::string> &texts,
+                                 CancellationTokenPtr cancel) {
+  cancelled = false;
+  error.clear();
+
+  // Map every segment to the first occurrence of its normal form
+  std::unordered_map<std::string, size_t> seen;
+  std::vector<std::string> distinct;
+  std::vector<size_t> slot(texts.size());
+  for (size_t i = 0; i < texts.size(); i++) {
+    auto [it, inserted] = seen.emplace(normalize_segment(texts[i]),
+                                       distinct.size());
+    if (inserted) {
+      distinct.push_back(texts[i]);
+    }
+    slot[i] = it->second;
+  }
+
+  if (distinct.size() == texts.size()) {
+    return TranslateDistinct(texts, cancel);
+  }
+
+  std::cerr << "[DEBUG] " << (texts.size() - distinct.size()) << " of "
+            << texts.size() << " segments are duplicates" << std::endl;
+
+  std::vector<std::string> translated = TranslateDistinct(distinct, cancel);
+  translated.resize(distinct.size());
+
+  std::vector<std::string> outputs;
+  outputs.reserve(texts.size());
+  for (size_t i = 0; i < texts.size(); i++) {
+    outputs.push_back(translated[slot[i]]);
+  }
+  return outputs;
+}
+
+std::vector<std::string>
+TranslationChain::TranslateDistinct(const std::vector<std::string> &texts,
+                                    const CancellationTokenPtr &cancel) {
+  if (hops.empty()) {
+    return texts;
+  }
+
+  // Each hop reads text, or the previous hop's tokens when they share a
+  // tokenizer
+  std::vector<std::string> current = texts;
+  BatchScheduler::TokenBatch tokens;
+  bool have_text = true;
+
+  for (size_t i = 0; i < hops.size(); i++) {
+    if (cancel && cancel->IsCancelled()) {
+      // Output of an earlier hop is in the wrong language; nothing to return
+      cancelled = true;
+      error = cancel->DeadlinePassed() ? "Translation deadline exceeded"
+                                       : "Translation cancelled";
+      std::cerr << "[WARN] " << error << " before hop " << (i + 1) << " of "
+                << hops.size() << std::endl;
+      return std::vector<std::string>(texts.size());
+    }
+
+    // Segments in the translation memory skip decoding for this hop
+    std::vector<std::string> outputs(texts.size());
+    std::vector<bool> remembered(texts.size(), false);
+    if (have_text && hops[i].memory) {
+      size_t hits = 0;
+      for (size_t j = 0; j < texts.size(); j++) {
+        remembered[j] = hops[i].memory->Lookup(current[j], outputs[j]);
+        hits += remembered[j] ? 1 : 0;
+      }
+      std::cerr << "[DEBUG] Hop " << (i + 1) << ": " << hits << " of "
+                << texts.size() << " segments from translation memory"
+                << std::endl;
+    }
+
+    TranslationModel &translator = hops[i].scheduler->GetTranslator();
+    BatchScheduler::TokenBatch pending;
+    std::vector<size_t> pending_index;
+    for (size_t j = 0; j < texts.size(); j++) {
+      if (!remembered[j]) {
+        pending.push_back(have_text ? translator.encode(current[j])
+                                    : std::move(tokens[j]));
+        pending_index.push_back(j);
+      }
+    }
+
+    BatchScheduler::TokenBatch translated;
+    if (!pending.empty()) {
+      try {
+        translated = hops[i].scheduler->TranslateTokens(std::move(pending),
+                                                        cancel);
+      } catch (const std::exception &e) {
+        error = "Hop " + std::to_string(i + 1) + " (" + hops[i].from + "->" +
+                hops[i].to + ") failed: " + e.what();
+        std::cerr << "[ERROR] " << error << std::endl;
+        return std::vector<std::string>(texts.size());
+      }
+    }
+    translated.resize(pending_index.size());
+
+    // Adjacent packages with the same tokenizer model read the previous
+    // hop's tokens as-is, skipping detokenize/clean-up/retokenize. A next
+    // hop with a translation memory needs the text to look it up.
+    if (i + 1 < hops.size() && !hops[i + 1].memory &&
+        SharesTokenizer(hops[i], hops[i + 1])) {
+      std::cerr << "[DEBUG] Hop " << (i + 1)
+                << " passes tokens directly to the next hop" << std::endl;
+      TranslationModel &next = hops[i + 1].scheduler->GetTranslator();
+      tokens.assign(texts.size(), {});
+      for (size_t k = 0; k < pending_index.size(); k++) {
+        tokens[pending_index[k]] = std::move(translated[k]);
+      }
+      for (size_t j = 0; j < texts.size(); j++) {
+        if (remembered[j]) {
+          tokens[j] = next.encode(outputs[j]);
+        }
+      }
+      have_text = false;
+      continue;
+    }
+
+    for (size_t k = 0; k < pending_index.size(); k++) {
+      outputs[pending_index[k]] =
+          clean_translation_output(translator.decode(translated[k]));
+    }
+    current = std::move(outputs);
+    have_text = true;
+
+    if (current.size() == 1) {
+      std::cerr << "[DEBUG] Hop " << (i + 1) << " result: " << current[0]
+                << std::endl;
+    }
+  }
+
+  if (cancel && cancel->IsCancelled()) {
+    cancelled = true;
+    error = cancel->DeadlinePassed() ? "Translation deadline exceeded"
+                                     : "Translation cancelled";
+    std::cerr << "[WARN] " << error << " during the last hop" << std::endl;
+  }
+
+  return current;
+}
+
+bool TranslationChain::SharesTokenizer(const Hop &a, const Hop &b) {
+  const std::string &hash_a = a.scheduler->GetTranslator().tokenizer_hash();
+  return !hash_a.empty() &&
+         hash_a == b.scheduler->GetTranslator().tokenizer_hash();
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "cancellation.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class BatchScheduler;
+class TranslationMemory;
+
+// Files that make up an installed Argos package
+struct PackageFiles {
+  std::string name;
+  std::string dir;
+  std::string model_dir;
+  std::string tokenizer_model; // sentencepiece.model or bpe.model
+};
+
+// Locate the model directory and tokenizer of an installed package
+PackageFiles ResolvePackageFiles(const std::string &packages_dir,
+                                 const std::string &pkg_name);
+
+// A route of one or more hops (e.g. de -> en -> es) with every hop's model
+// loaded once, so many segments can be pushed through it. Models come from
+// the ModelCache, so chains on different threads share them.
+class TranslationChain {
+public:
+  // Load a model for each consecutive pair in route.
+  // On failure GetError() describes which hop could not be prepared.
+  bool Load(const std::string &packages_dir,
+            const std::vector<std::string> &route);
+
+  // Translate a single text through every hop
+  std::string Translate(const std::string &text,
+                        CancellationTokenPtr cancel = nullptr);
+
+  // Translate a batch of segments through every hop, keeping input order.
+  // Repeated segments (equal after whitespace normalization) are translated
+  // once and the result is copied to every position they occur in.
+  // There is always one result per segment; GetError() is empty only if all
+  // of them are complete translations. If a model fails, the results are
+  // empty. If cancel fires, the remaining hops are skipped: results are
+  // partial when it fired during the last hop and empty otherwise, and
+  // WasCancelled() reports it.
+  std::vector<std::string> TranslateBatch(const std::vector<std::string> &texts,
+                                          CancellationTokenPtr cancel = nullptr);
+
+  size_t GetHopCount() const { return hops.size(); }
+  // Languages and packages of every hop ("de>en:translate-de_en-1_0 ..."),
+  // identifying the translation the chain produces
+  std::string GetRouteId() const;
+  const std::string &GetError() const { return error; }
+  bool WasCancelled() const { return cancelled; }
+
+private:
+  struct Hop {
+    std::string from;
+    std::string to;
+    PackageFiles package;
+    std::shared_ptr<BatchScheduler> scheduler;
+    std::shared_ptr<TranslationMemory> memory; // Null without one
+  };
+
+  // Run distinct segments through the hops. Text is cleaned (HTML entities,
+  // SentencePiece markers) whenever it is detokenized; hops sharing a
+  // tokenizer exchange tokens directly. A hop takes segments found in its
+  // translation memory from there instead of decoding them.
+  std::vector<std::string>
+  TranslateDistinct(const std::vector<std::string> &texts,
+                    const CancellationTokenPtr &cancel);
+
+  static bool SharesTokenizer(const Hop &a, const Hop &b);
+
+  std::vector<Hop> hops;
+  std::string error;
+  bool cancelled = false;
+};
@@ -0,0 +1,261 @@
+#include "translation_memory.h"
+#include "utils.h"
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// "de-DE", "DE" and "de_de" all mean "de"
+std::string primary_language(const std::string &code) {
+  std::string primary;
+  for (char c : code) {
+    if (c == '-' || c == '_') {
+      break;
+    }
+    primary += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return primary;
+}
+
+void append_utf8(unsigned long code, std::string &out) {
+  if (code < 0x80) {
+    out += static_cast<char>(code);
+  } else if (code < 0x800) {
+    out += static_cast<char>(0xC0 | (code >> 6));
+    out += static_cast<char>(0x80 | (code & 0x3F));
+  } else if (code < 0x10000) {
+    out += static_cast<char>(0xE0 | (code >> 12));
+    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (code & 0x3F));
+  } else if (code < 0x110000) {
+    out += static_cast<char>(0xF0 | (code >> 18));
+    out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (code & 0x3F));
+  }
+}
+
+// XML text to plain UTF-8: named and numeric character references
+std::string decode_xml(const std::string &text) {
+  static const std::pair<const char *, char> named[] = {
+      {"amp", '&'}, {"lt", '<'}, {"gt", '>'}, {"quot", '"'}, {"apos", '\''}};
+  std::string out;
+  out.reserve(text.size());
+  for (size_t i = 0; i < text.size(); i++) {
+    const size_t semi = text[i] == '&' ? text.find(';', i) : std::string::npos;
+    if (semi == std::string::npos || semi - i > 10) {
+      out += text[i];
+      continue;
+    }
+    const std::string name = text.substr(i + 1, semi - i - 1);
+    bool decoded = false;
+    if (name.size() > 1 && name[0] == '#') {
+      try {
+        const bool hex = name[1] == 'x' || name[1] == 'X';
+        const unsigned long code =
+            std::stoul(name.substr(hex ? 2 : 1), nullptr, hex ? 16 : 10);
+        append_utf8(code, out);
+        decoded = true;
+      } catch (const std::exception &) {
+      }
+    } else {
+      for (const auto &[entity, c] : named) {
+        if (name == entity) {
+          out += c;
+          decoded = true;
+        }
+      }
+    }
+    if (decoded) {
+      i = semi;
+    } else {
+      out += text[i];
+    }
+  }
+  return out;
+}
+
+// Text of a <seg>: inline code elements are removed with their content,
+// other inline tags are unwrapped
+std::string segment_text(const std::string &seg) {
+  static const char *const code_elements[] = {"bpt", "ept", "ph", "it", "ut"};
+  std::string out;
+  size_t i = 0;
+  while (i < seg.size()) {
+    if (seg[i] != '<') {
+      const size_t next = seg.find('<', i);
+      const size_t end = next == std::string::npos ? seg.size() : next;
+      out += seg.substr(i, end - i);
+      i = end;
+      continue;
+    }
+    const size_t tag_end = seg.find('>', i);
+    if (tag_end == std::string::npos) {
+      break;
+    }
+    size_t name_end = i + 1;
+    while (name_end < tag_end && std::isalpha(static_cast<unsigned char>(
+                                     seg[name_end]))) {
+      name_end++;
+    }
+    const std::string name = seg.substr(i + 1, name_end - i - 1);
+    i = tag_end + 1;
+    if (seg[tag_end - 1] == '/') {
+      continue;
+    }
+    for (const char *code : code_elements) {
+      if (name == code) {
+        const size_t close = seg.find("</" + name, i);
+        const size_t close_end =
+            close == std::string::npos ? close : seg.find('>', close);
+        i = close_end == std::string::npos ? seg.size() : close_end + 1;
+        break;
+      }
+    }
+  }
+  return normalize_segment(decode_xml(out));
+}
+
+// Value of attr="..." inside a start tag
+std::string attribute(const std::string &tag, const std::string &attr) {
+  size_t pos = tag.find(attr + "=\"");
+  if (pos == std::string::npos) {
+    return "";
+  }
+  pos += attr.size() + 2;
+  const size_t end = tag.find('"', pos);
+  return end == std::string::npos ? "" : tag.substr(pos, end - pos);
+}
+
+// Pull the two languages out of one <tu>...</tu>
+void parse_unit(const std::string &unit, const std::string &from,
+                const std::string &to, SegmentPairs &pairs) {
+  std::string source;
+  std::string target;
+  size_t pos = 0;
+  while ((pos = unit.find("<tuv", pos)) != std::string::npos) {
+    const size_t tag_end = unit.find('>', pos);
+    const size_t seg = unit.find("<seg", pos);
+    if (tag_end == std::string::npos || seg == std::string::npos) {
+      break;
+    }
+    const size_t seg_start = unit.find('>', seg);
+    const size_t seg_end = unit.find("</seg>", seg);
+    if (seg_start == std::string::npos || seg_end == std::string::npos) {
+      break;
+    }
+    const std::string tag = unit.substr(pos, tag_end - pos);
+    std::string lang = attribute(tag, "xml:lang");
+    if (lang.empty()) {
+      lang = attribute(tag, "lang");
+    }
+    const std::string text =
+        segment_text(unit.substr(seg_start + 1, seg_end - seg_start - 1));
+    if (primary_language(lang) == from && source.empty()) {
+      source = text;
+    } else if (primary_language(lang) == to && target.empty()) {
+      target = text;
+    }
+    pos = seg_end;
+  }
+  if (!source.empty() && !target.empty()) {
+    pairs.emplace_back(std::move(source), std::move(target));
+  }
+}
+
+} // namespace
+
+std::string TranslationMemory::GetPath(const std::string &from,
+                                       const std::string &to) {
+  return get_config_dir() + "/memory/" + from + "_" + to + ".tm";
+}
+
+bool TranslationMemory::Open(const std::string &path) {
+  return std::filesystem::exists(path) && table.Open(path);
+}
+
+bool TranslationMemory::Lookup(const std::string &segment,
+                               std::string &translation) const {
+  return table.LookupExact(normalize_segment(segment), translation);
+}
+
+bool TranslationMemory::Import(const std::string &path,
+                               const SegmentPairs &pairs, size_t &total) {
+  // New pairs go first: Write keeps the first entry of a duplicated key
+  SegmentPairs entries;
+  for (const auto &[source, target] : pairs) {
+    entries.emplace_back(normalize_segment(source), target);
+  }
+  WordDictionary existing;
+  if (std::filesystem::exists(path) && existing.Open(path)) {
+    const SegmentPairs old = existing.Entries();
+    entries.insert(entries.end(), old.begin(), old.end());
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(
+      std::filesystem::path(path).parent_path(), ec);
+  if (!WordDictionary::Write(path, entries)) {
+    std::cerr << "[ERROR] Failed to write translation memory " << path
+              << std::endl;
+    return false;
+  }
+  WordDictionary written;
+  total = written.Open(path) ? written.Size() : 0;
+  return true;
+}
+
+bool ReadTmx(const std::string &path, const std::string &from,
+             const std::string &to, SegmentPairs &pairs) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open()) {
+    std::cerr << "[ERROR] Cannot open " << path << std::endl;
+    return false;
+  }
+
+  const std::string source_lang = primary_language(from);
+  const std::string target_lang = primary_language(to);
+
+  // Only the unit being parsed is held in memory
+  std::string buffer;
+  std::vector<char> chunk(64 * 1024);
+  while (in.read(chunk.data(), chunk.size()) || in.gcount() > 0) {
+    buffer.append(chunk.data(), static_cast<size_t>(in.gcount()));
+    size_t end;
+    while ((end = buffer.find("</tu>")) != std::string::npos) {
+      parse_unit(buffer.substr(0, end), source_lang, target_lang, pairs);
+      buffer.erase(0, end + 5);
+    }
+  }
+  return true;
+}
+
+bool ReadTsv(const std::string &path, SegmentPairs &pairs) {
+  std::ifstream in(path);
+  if (!in.is_open()) {
+    std::cerr << "[ERROR] Cannot open " << path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    const size_t tab = line.find('\t');
+    if (tab == std::string::npos) {
+      continue;
+    }
+    const size_t next_tab = line.find('\t', tab + 1);
+    std::string source = normalize_segment(line.substr(0, tab));
+    std::string target = normalize_segment(line.substr(
+        tab + 1, next_tab == std::string::npos ? std::string::npos
+                                                : next_tab - tab - 1));
+    if (!source.empty() && !target.empty()) {
+      pairs.emplace_back(std::move(source), std::move(target));
+    }
+  }
+  return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "word_dictionary.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+using SegmentPairs = std::vector<std::pair<std::string, std::string>>;
+
+// Human-approved translations for one language pair, consulted before a
+// package's model is asked. Keys are normalized segments (see
+// normalize_segment), so whitespace differences still match. Keyed by the
+// pair rather than the package directory, so approved translations survive
+// package upgrades.
+class TranslationMemory {
+public:
+  // ~/.config/fast-translator/memory/<from>_<to>.tm
+  static std::string GetPath(const std::string &from, const std::string &to);
+
+  // Returns false if there is no memory for the pair
+  bool Open(const std::string &path);
+
+  bool Lookup(const std::string &segment, std::string &translation) const;
+
+  size_t Size() const { return table.Size(); }
+
+  // Merge pairs into the memory at path; they replace existing translations
+  // of the same segment. total receives the resulting number of entries.
+  static bool Import(const std::string &path, const SegmentPairs &pairs,
+                     size_t &total);
+
+private:
+  WordDictionary table;
+};
+
+// Stream translation units out of a TMX file, keeping the <seg> text of the
+// variants in the two languages ("de" matches "de-DE"). Inline codes
+// (<bpt>, <ph>, ...) are dropped and entities decoded.
+bool ReadTmx(const std::string &path, const std::string &from,
+             const std::string &to, SegmentPairs &pairs);
+
+// "source<TAB>translation" lines; other columns and malformed lines are
+// ignored
+bool ReadTsv(const std::string &path, SegmentPairs &pairs);
@@ -0,0 +1,34 @@
+#pragma once
+#include "cancellation.h"
+#include "thread_planner.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// What the orchestration layer (ModelCache, BatchScheduler,
+// TranslationChain) needs from one loaded translation model.
+// ArgosTranslator runs CTranslate2; MockTranslator fakes it for benchmarks.
+class TranslationModel {
+public:
+  virtual ~TranslationModel() = default;
+
+  // Applied when the model is loaded
+  virtual void set_workload(const Workload &workload) = 0;
+  virtual void set_max_chunk_tokens(size_t max_tokens) = 0;
+
+  virtual bool load_model(const std::string &model_path,
+                          const std::string &tokenizer_path) = 0;
+
+  virtual std::vector<std::string> encode(const std::string &text) = 0;
+  virtual std::string decode(const std::vector<std::string> &tokens) = 0;
+
+  // Translate a batch of token sequences; see ArgosTranslator for the
+  // meaning of cancel
+  virtual std::vector<std::vector<std::string>>
+  translate_tokens(const std::vector<std::vector<std::string>> &batch,
+                   const std::vector<const CancellationToken *> &cancel =
+                       {}) = 0;
+
+  // Equal non-empty hashes mean token sequences can be exchanged directly
+  virtual const std::string &tokenizer_hash() const = 0;
+};
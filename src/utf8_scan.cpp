@@ -0,0 +1,115 @@
+#include "utf8_scan.h"
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const size_t kBlock = 16;
+
+// Leading ASCII bytes of the 16 at p
+size_t ascii_prefix(const char *p) {
+#if defined(__SSE2__)
+  const int high_bits =
+      _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+  return high_bits == 0 ? kBlock : __builtin_ctz(high_bits);
+#else
+#if defined(__aarch64__)
+  if (vmaxvq_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(p))) < 0x80) {
+    return kBlock;
+  }
+#else
+  uint64_t words[2];
+  std::memcpy(words, p, sizeof(words));
+  if (((words[0] | words[1]) & 0x8080808080808080ULL) == 0) {
+    return kBlock;
+  }
+#endif
+  size_t count = 0;
+  while (count < kBlock && static_cast<unsigned char>(p[count]) < 0x80) {
+    count++;
+  }
+  return count;
+#endif
+}
+
+bool continuation(unsigned char c) { return (c & 0xC0) == 0x80; }
+
+// Length of the valid sequence starting with a non-ASCII byte at text[i],
+// 0 if there is none (Unicode 15, table 3-7)
+size_t sequence_length(std::string_view text, size_t i) {
+  const unsigned char lead = text[i];
+  const size_t left = text.size() - i;
+  auto byte = [&](size_t k) { return static_cast<unsigned char>(text[i + k]); };
+
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    return left >= 2 && continuation(byte(1)) ? 2 : 0;
+  }
+  if (lead >= 0xE0 && lead <= 0xEF) {
+    if (left < 3 || !continuation(byte(1)) || !continuation(byte(2))) {
+      return 0;
+    }
+    // No overlong forms below U+0800, no UTF-16 surrogates
+    if ((lead == 0xE0 && byte(1) < 0xA0) || (lead == 0xED && byte(1) > 0x9F)) {
+      return 0;
+    }
+    return 3;
+  }
+  if (lead >= 0xF0 && lead <= 0xF4) {
+    if (left < 4 || !continuation(byte(1)) || !continuation(byte(2)) ||
+        !continuation(byte(3))) {
+      return 0;
+    }
+    // No overlong forms below U+10000, nothing past U+10FFFF
+    if ((lead == 0xF0 && byte(1) < 0x90) || (lead == 0xF4 && byte(1) > 0x8F)) {
+      return 0;
+    }
+    return 4;
+  }
+  return 0;
+}
+
+} // namespace
+
+size_t SplitUtf8(std::string_view text, std::vector<uint32_t> &boundaries) {
+  // At most one character per byte: reserve once, then append without
+  // zero-filling slots that multi-byte characters leave unused
+  boundaries.reserve(boundaries.size() + text.size());
+
+  size_t first_invalid = std::string::npos;
+  const size_t size = text.size();
+  size_t i = 0;
+  while (i < size) {
+    size_t ascii = 0;
+    if (size - i >= kBlock) {
+      ascii = ascii_prefix(text.data() + i);
+    } else {
+      while (i + ascii < size &&
+             static_cast<unsigned char>(text[i + ascii]) < 0x80) {
+        ascii++;
+      }
+    }
+    for (size_t k = 0; k < ascii; k++) {
+      boundaries.push_back(static_cast<uint32_t>(i + k));
+    }
+    i += ascii;
+
+    // Decode the multi-byte run up to the next ASCII byte
+    while (i < size && static_cast<unsigned char>(text[i]) >= 0x80) {
+      size_t length = sequence_length(text, i);
+      if (length == 0) {
+        if (first_invalid == std::string::npos) {
+          first_invalid = i;
+        }
+        length = 1;
+      }
+      boundaries.push_back(static_cast<uint32_t>(i));
+      i += length;
+    }
+  }
+  return first_invalid;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Code-point boundaries of UTF-8 text, found 16 bytes at a time: runs of
+// ASCII are recognized with one vector compare (SSE2 on x86-64, NEON on
+// ARM64, 8-byte words elsewhere) and only multi-byte sequences are decoded
+// one by one, with the full validity rules of the Unicode standard
+// (no overlong forms, surrogates or code points past U+10FFFF).
+
+// Appends the offset of every character's first byte to boundaries, which
+// only grows, so a reused vector costs no allocation. A byte that does
+// not start a valid sequence counts as a character of its own. Returns the
+// offset of the first such byte, or std::string::npos for valid UTF-8.
+size_t SplitUtf8(std::string_view text, std::vector<uint32_t> &boundaries);
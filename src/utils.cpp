@@ -1,12 +1,17 @@
 #include "utils.h"
 #include <array>
+#include <atomic>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <unistd.h>
 
 // Helper to execute shell command and get output
 std::string exec(const char *cmd) {
@@ -202,3 +207,79 @@ std::string decode_html_entities(const std::string &text) {
   }
   return result;
 }
+
+std::string clean_translation_output(const std::string &text) {
+  std::string result = decode_html_entities(text);
+
+  // Clean SentencePiece artifacts (▁ = U+2581, UTF-8: E2 96 81)
+  const std::string sp_marker = "\xE2\x96\x81"; // ▁
+  // Replace internal markers with spaces
+  size_t pos = 0;
+  while ((pos = result.find(sp_marker, pos)) != std::string::npos) {
+    if (pos == 0) {
+      // Remove leading marker
+      result.erase(pos, sp_marker.length());
+    } else {
+      // Replace with space
+      result.replace(pos, sp_marker.length(), " ");
+      pos += 1;
+    }
+  }
+  return result;
+}
+
+std::string unique_temp_path(const std::string &path) {
+  static std::atomic<unsigned> counter{0};
+  return path + ".tmp." + std::to_string(getpid()) + "." +
+         std::to_string(counter++);
+}
+
+std::string hash_file_contents(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return "";
+  }
+
+  uint64_t hash = 14695981039346656037ull; // FNV offset basis
+  char buffer[64 * 1024];
+  while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+    const std::streamsize count = file.gcount();
+    for (std::streamsize i = 0; i < count; i++) {
+      hash ^= static_cast<unsigned char>(buffer[i]);
+      hash *= 1099511628211ull; // FNV prime
+    }
+  }
+
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016llx",
+                static_cast<unsigned long long>(hash));
+  return hex;
+}
+
+std::string get_config_dir() {
+  const char *home = std::getenv("HOME");
+  if (!home)
+    return "."; // Fallback to current dir
+
+  std::string config_dir = std::string(home) + "/.config/fast-translator";
+  std::error_code ec;
+  std::filesystem::create_directories(config_dir, ec);
+  return config_dir;
+}
+
+std::string normalize_segment(const std::string &text) {
+  std::string result;
+  result.reserve(text.size());
+  bool pending_space = false;
+  for (char c : text) {
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      pending_space = !result.empty();
+    } else {
+      if (pending_space)
+        result += ' ';
+      pending_space = false;
+      result += c;
+    }
+  }
+  return result;
+}
@@ -7,5 +7,18 @@ void paste_clipboard();
 void notify_user(const std::string &title, const std::string &message);
 void show_log_dialog(const std::string &log_content);
 std::string decode_html_entities(const std::string &text);
+// Decode HTML entities and strip SentencePiece word markers from raw model
+// output
+std::string clean_translation_output(const std::string &text);
+// Trim and collapse whitespace runs to single spaces. Tokenizers ignore these
+// differences, so segments with equal normal forms translate identically.
+std::string normalize_segment(const std::string &text);
+// ~/.config/fast-translator (created if missing), "." without HOME
+std::string get_config_dir();
+// Name for a temporary file next to path, unique to this process and call,
+// so concurrent writers never share one before renaming it over path
+std::string unique_temp_path(const std::string &path);
+// FNV-1a hash of a file's contents as hex, empty if it cannot be read
+std::string hash_file_contents(const std::string &path);
 std::string translate_text(const std::string &text,
                            const std::string &model_dir);
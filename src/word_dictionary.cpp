@@ -0,0 +1,226 @@
+#include "word_dictionary.h"
+#include "utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+namespace {
+
+const char kMagic[8] = {'F', 'T', 'D', 'I', 'C', 'T', '1', '\0'};
+const size_t kHeaderSize = 16;
+
+struct IndexEntry {
+  uint32_t key_offset;
+  uint32_t key_length;
+  uint32_t value_offset;
+  uint32_t value_length;
+};
+static_assert(sizeof(IndexEntry) == 16, "Dictionary index must be packed");
+
+std::string ascii_lower(const std::string &text) {
+  std::string lower = text;
+  for (char &c : lower) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return lower;
+}
+
+// Give translation the capitalization pattern of word: ALL CAPS or Capital
+void restore_case(const std::string &word, std::string &translation) {
+  bool has_alpha = false;
+  bool all_upper = true;
+  for (unsigned char c : word) {
+    if (std::isalpha(c)) {
+      has_alpha = true;
+      all_upper = all_upper && std::isupper(c);
+    }
+  }
+  if (!has_alpha || translation.empty()) {
+    return;
+  }
+  if (all_upper && word.size() > 1) {
+    for (char &c : translation) {
+      c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+  } else if (std::isupper(static_cast<unsigned char>(word[0]))) {
+    translation[0] = static_cast<char>(
+        std::toupper(static_cast<unsigned char>(translation[0])));
+  }
+}
+
+} // namespace
+
+WordDictionary::~WordDictionary() { Close(); }
+
+void WordDictionary::Close() {
+  file.Close();
+  count = 0;
+  blobSize = 0;
+}
+
+bool WordDictionary::Open(const std::string &path) {
+  Close();
+  if (!file.Open(path)) {
+    return false;
+  }
+  const char *data = file.Data();
+  const size_t size = file.Size();
+
+  if (size < kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+    std::cerr << "[WARN] Not a dictionary file: " << path << std::endl;
+    Close();
+    return false;
+  }
+  uint32_t entries = 0;
+  std::memcpy(&entries, data + 8, sizeof(entries));
+  const size_t index_end = kHeaderSize + size_t(entries) * sizeof(IndexEntry);
+  if (index_end > size) {
+    std::cerr << "[WARN] Truncated dictionary: " << path << std::endl;
+    Close();
+    return false;
+  }
+
+  count = entries;
+  blobSize = size - index_end;
+  return true;
+}
+
+bool WordDictionary::LookupExact(const std::string &key,
+                                 std::string &value) const {
+  if (!file.Data()) {
+    return false;
+  }
+  const char *index = file.Data() + kHeaderSize;
+  const char *blob = index + size_t(count) * sizeof(IndexEntry);
+  auto entry_at = [index](uint32_t i) {
+    IndexEntry entry;
+    std::memcpy(&entry, index + size_t(i) * sizeof(IndexEntry), sizeof(entry));
+    return entry;
+  };
+
+  uint32_t low = 0;
+  uint32_t high = count;
+  while (low < high) {
+    const uint32_t mid = low + (high - low) / 2;
+    const IndexEntry entry = entry_at(mid);
+    // Offsets are checked as they are read, so opening stays O(1)
+    if (size_t(entry.key_offset) + entry.key_length > blobSize ||
+        size_t(entry.value_offset) + entry.value_length > blobSize) {
+      return false;
+    }
+    const int order =
+        std::string_view(blob + entry.key_offset, entry.key_length)
+            .compare(key);
+    if (order == 0) {
+      value.assign(blob + entry.value_offset, entry.value_length);
+      return true;
+    }
+    if (order < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return false;
+}
+
+bool WordDictionary::Lookup(const std::string &word,
+                            std::string &translation) const {
+  if (!file.Data() || word.empty()) {
+    return false;
+  }
+  if (LookupExact(word, translation)) {
+    return true;
+  }
+  const std::string lower = ascii_lower(word);
+  if (lower != word && LookupExact(lower, translation)) {
+    restore_case(word, translation);
+    return true;
+  }
+  return false;
+}
+
+std::vector<std::pair<std::string, std::string>>
+WordDictionary::Entries() const {
+  std::vector<std::pair<std::string, std::string>> entries;
+  if (!file.Data()) {
+    return entries;
+  }
+  const char *index = file.Data() + kHeaderSize;
+  const char *blob = index + size_t(count) * sizeof(IndexEntry);
+  entries.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    IndexEntry entry;
+    std::memcpy(&entry, index + size_t(i) * sizeof(IndexEntry), sizeof(entry));
+    if (size_t(entry.key_offset) + entry.key_length > blobSize ||
+        size_t(entry.value_offset) + entry.value_length > blobSize) {
+      continue;
+    }
+    entries.emplace_back(std::string(blob + entry.key_offset, entry.key_length),
+                         std::string(blob + entry.value_offset,
+                                     entry.value_length));
+  }
+  return entries;
+}
+
+bool WordDictionary::Write(
+    const std::string &path,
+    std::vector<std::pair<std::string, std::string>> entries) {
+  std::stable_sort(
+      entries.begin(), entries.end(),
+      [](const auto &a, const auto &b) { return a.first < b.first; });
+  entries.erase(std::unique(entries.begin(), entries.end(),
+                            [](const auto &a, const auto &b) {
+                              return a.first == b.first;
+                            }),
+                entries.end());
+
+  std::vector<IndexEntry> index;
+  std::string blob;
+  index.reserve(entries.size());
+  for (const auto &[key, value] : entries) {
+    IndexEntry entry;
+    entry.key_offset = static_cast<uint32_t>(blob.size());
+    entry.key_length = static_cast<uint32_t>(key.size());
+    blob += key;
+    entry.value_offset = static_cast<uint32_t>(blob.size());
+    entry.value_length = static_cast<uint32_t>(value.size());
+    blob += value;
+    index.push_back(entry);
+  }
+
+  // Write a file of our own next to the target and rename it, so concurrent
+  // imports never interleave and a running lookup never maps a half-written
+  // file
+  const std::string tmp_path = unique_temp_path(path);
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+    const uint32_t header[2] = {static_cast<uint32_t>(index.size()), 0};
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(index.data()),
+              index.size() * sizeof(IndexEntry));
+    out.write(blob.data(), blob.size());
+    if (!out) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    std::filesystem::remove(tmp_path, ec);
+    return false;
+  }
+  return true;
+}
+
+std::string GetDictionaryPath(const std::string &package_dir) {
+  return package_dir + "/dictionary.bin";
+}
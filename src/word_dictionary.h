@@ -0,0 +1,54 @@
+#pragma once
+#include "mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Read-only word -> translation table for one package, memory-mapped from
+// <package>/dictionary.bin. Keys are sorted, so a lookup is a binary search
+// over the mapped index with no parsing or allocation up front. Translation
+// memories use the same format with whole segments as keys.
+//
+// File layout (host byte order):
+//   char     magic[8]    "FTDICT1"
+//   uint32_t count, reserved
+//   count x { uint32_t key_offset, key_length, value_offset, value_length }
+//   string data (offsets are relative to its start)
+class WordDictionary {
+public:
+  WordDictionary() = default;
+  ~WordDictionary();
+
+  WordDictionary(const WordDictionary &) = delete;
+  WordDictionary &operator=(const WordDictionary &) = delete;
+
+  // Map the file and validate its index. Returns false if it is missing or
+  // malformed.
+  bool Open(const std::string &path);
+
+  // Exact lookup, then a lowercase lookup whose result gets the input's
+  // capitalization back (e.g. "Haus" finds "haus" -> "house" -> "House")
+  bool Lookup(const std::string &word, std::string &translation) const;
+  bool LookupExact(const std::string &key, std::string &value) const;
+
+  size_t Size() const { return count; }
+
+  // Every valid entry in key order, e.g. to merge new entries into the file
+  std::vector<std::pair<std::string, std::string>> Entries() const;
+
+  // Write a dictionary file; entries need not be sorted, later duplicates
+  // are dropped
+  static bool Write(const std::string &path,
+                    std::vector<std::pair<std::string, std::string>> entries);
+
+private:
+  void Close();
+
+  MappedFile file;
+  uint32_t count = 0;
+  size_t blobSize = 0;
+};
+
+std::string GetDictionaryPath(const std::string &package_dir);
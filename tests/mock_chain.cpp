@@ -0,0 +1,84 @@
+#include "mock_chain.h"
+#include "mock_translator.h"
+#include "model_cache.h"
+#include "package_stats.h"
+#include "test.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+std::mutex mock_mutex;
+std::vector<std::string> segments;
+std::string failure_token;
+
+// MockTranslator that remembers what it was asked to translate, so tests
+// can see how callers grouped their text into segments, and fails on demand
+class RecordingTranslator : public MockTranslator {
+public:
+  std::vector<std::vector<std::string>>
+  translate_tokens(const std::vector<std::vector<std::string>> &batch,
+                   const std::vector<const CancellationToken *> &cancel =
+                       {}) override {
+    {
+      std::lock_guard<std::mutex> lock(mock_mutex);
+      for (const auto &tokens : batch) {
+        if (!failure_token.empty() &&
+            std::find(tokens.begin(), tokens.end(), failure_token) !=
+                tokens.end()) {
+          throw std::runtime_error("mock failure on " + failure_token);
+        }
+        std::string joined;
+        for (const std::string &token : tokens) {
+          joined += (joined.empty() ? "" : " ") + token;
+        }
+        segments.push_back(joined);
+      }
+    }
+    return MockTranslator::translate_tokens(batch, cancel);
+  }
+};
+
+} // namespace
+
+void SetMockFailure(const std::string &token) {
+  std::lock_guard<std::mutex> lock(mock_mutex);
+  failure_token = token;
+}
+
+std::vector<std::string> TakeMockSegments() {
+  std::lock_guard<std::mutex> lock(mock_mutex);
+  std::vector<std::string> taken;
+  taken.swap(segments);
+  return taken;
+}
+
+bool LoadMockChain(TranslationChain &chain,
+                   const std::vector<std::string> &route) {
+  static const std::string packages_dir = [] {
+    const std::filesystem::path root = MakeTempDir();
+    setenv("HOME", root.c_str(), 1);
+    ModelCache::GetInstance().SetModelFactory(
+        [] { return std::make_shared<RecordingTranslator>(); });
+    PackageStats::GetInstance().SetRecording(false);
+
+    // de_en and en_es share a tokenizer, so de->en->es passes tokens
+    const char *packages_and_tokenizers[][2] = {{"de_en", "shared"},
+                                                {"en_de", "en_de"},
+                                                {"en_es", "shared"},
+                                                {"es_en", "es_en"}};
+    const std::filesystem::path packages = root / "packages";
+    for (const auto &[pair, tokenizer] : packages_and_tokenizers) {
+      const std::filesystem::path dir =
+          packages / ("translate-" + std::string(pair) + "-test");
+      std::filesystem::create_directories(dir / "model");
+      std::ofstream(dir / "sentencepiece.model") << tokenizer;
+    }
+    return packages.string();
+  }();
+  return chain.Load(packages_dir, route);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "translation_chain.h"
+#include <string>
+#include <vector>
+
+// Load chain over MockTranslator models in a throwaway package tree (see
+// MockTranslator: letters are shifted, words keep their places), so code
+// built on chains runs without CTranslate2 models. HOME points at the tree
+// too, keeping the user's translation memories and stats out. Packages
+// de_en and en_de, en_es and es_en exist; de_en and en_es share a tokenizer.
+bool LoadMockChain(TranslationChain &chain,
+                   const std::vector<std::string> &route);
+
+// Inputs the mock models received since the last call, one per segment as
+// its tokens joined by spaces, in the order they were translated
+std::vector<std::string> TakeMockSegments();
+
+// Make the mock models throw on batches containing token, as a failing
+// model would; an empty token turns failures off
+void SetMockFailure(const std::string &token);
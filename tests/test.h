@@ -0,0 +1,43 @@
+#pragma once
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Minimal self-registering checks, run by Fast_translator_tests. A failed
+// CHECK reports and lets the test continue; the run fails if any did.
+
+struct TestCase {
+  const char *name;
+  void (*run)();
+};
+
+std::vector<TestCase> &TestRegistry();
+void ReportFailure(const char *file, int line, const std::string &message);
+
+// Fresh empty directory under the system temp directory
+std::string MakeTempDir();
+
+#define TEST(name)                                                            \
+  static void name();                                                         \
+  static const bool name##_registered =                                       \
+      (TestRegistry().push_back({#name, name}), true);                        \
+  static void name()
+
+#define CHECK(condition)                                                      \
+  do {                                                                        \
+    if (!(condition)) {                                                       \
+      ReportFailure(__FILE__, __LINE__, #condition);                          \
+    }                                                                         \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                            \
+  do {                                                                        \
+    const auto &actual_value = (actual);                                      \
+    const auto &expected_value = (expected);                                  \
+    if (!(actual_value == expected_value)) {                                  \
+      std::ostringstream message;                                             \
+      message << #actual " == " #expected ": got [" << actual_value           \
+              << "], expected [" << expected_value << "]";                    \
+      ReportFailure(__FILE__, __LINE__, message.str());                       \
+    }                                                                         \
+  } while (0)
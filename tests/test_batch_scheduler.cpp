@@ -0,0 +1,98 @@
+#include "batch_scheduler.h"
+#include "mock_translator.h"
+#include "test.h"
+#include <mutex>
+
+namespace {
+
+// MockTranslator that records how many segments each decode call held
+class CountingTranslator : public MockTranslator {
+public:
+  std::vector<std::vector<std::string>>
+  translate_tokens(const std::vector<std::vector<std::string>> &batch,
+                   const std::vector<const CancellationToken *> &cancel =
+                       {}) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      sizes.push_back(batch.size());
+    }
+    return MockTranslator::translate_tokens(batch, cancel);
+  }
+
+  std::vector<size_t> BatchSizes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sizes;
+  }
+
+private:
+  std::mutex mutex;
+  std::vector<size_t> sizes;
+};
+
+BatchSchedulerOptions LongWindow() {
+  // Long enough that every Submit in a test lands inside it
+  BatchSchedulerOptions options;
+  options.window = std::chrono::milliseconds(300);
+  return options;
+}
+
+} // namespace
+
+TEST(scheduler_joins_requests_in_the_window) {
+  auto model = std::make_shared<CountingTranslator>();
+  BatchScheduler scheduler(model, "test", LongWindow());
+  auto a = scheduler.Submit({{"ab"}});
+  auto b = scheduler.Submit({{"cd", "ef"}, {"gh"}});
+  auto c = scheduler.Submit({{"ij"}});
+
+  // MockTranslator shifts letters by one; each caller gets its own slice
+  CHECK(a.get() == BatchScheduler::TokenBatch{{"bc"}});
+  CHECK(b.get() == (BatchScheduler::TokenBatch{{"de", "fg"}, {"hi"}}));
+  CHECK(c.get() == BatchScheduler::TokenBatch{{"jk"}});
+  CHECK(model->BatchSizes() == std::vector<size_t>{4});
+}
+
+TEST(scheduler_segment_budget_closes_the_batch) {
+  auto model = std::make_shared<CountingTranslator>();
+  BatchSchedulerOptions options = LongWindow();
+  options.max_batch_segments = 4;
+  BatchScheduler scheduler(model, "test", options);
+
+  const auto start = std::chrono::steady_clock::now();
+  auto a = scheduler.Submit({{"a"}, {"b"}});
+  auto b = scheduler.Submit({{"c"}, {"d"}});
+  a.get();
+  b.get();
+  // A full batch is decoded without waiting for the window to close
+  CHECK(std::chrono::steady_clock::now() - start < options.window);
+
+  auto c = scheduler.Submit({{"e"}, {"f"}});
+  c.get();
+  CHECK(model->BatchSizes() == (std::vector<size_t>{4, 2}));
+}
+
+TEST(scheduler_token_budget_keeps_requests_whole) {
+  auto model = std::make_shared<CountingTranslator>();
+  BatchSchedulerOptions options = LongWindow();
+  options.max_batch_tokens = 5;
+  BatchScheduler scheduler(model, "test", options);
+
+  // Requests are never split: 3 + 3 tokens exceed the budget, and a
+  // request larger than the budget still goes out on its own
+  auto a = scheduler.Submit({{"a", "b", "c"}});
+  auto b = scheduler.Submit({{"d", "e", "f"}});
+  auto c = scheduler.Submit({{"g", "h", "i", "j", "k", "l", "m"}});
+  CHECK_EQ(a.get()[0].size(), 3u);
+  CHECK_EQ(b.get()[0].size(), 3u);
+  CHECK_EQ(c.get()[0].size(), 7u);
+  CHECK(model->BatchSizes() == (std::vector<size_t>{1, 1, 1}));
+}
+
+TEST(scheduler_empty_request_resolves_at_once) {
+  auto model = std::make_shared<CountingTranslator>();
+  BatchScheduler scheduler(model, "test", LongWindow());
+  auto empty = scheduler.Submit({});
+  CHECK(empty.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+  CHECK(empty.get().empty());
+  CHECK(model->BatchSizes().empty());
+}
@@ -0,0 +1,400 @@
+#include "bpe_rank_table.h"
+#include "moses_tokenizer.h"
+#include "test.h"
+#include "tokenizer_bpe.h"
+#include "utf8_scan.h"
+#include <climits>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+// Ties at equal symbols ("a a" then "aa a"), a repeated pair whose last
+// rank wins, multi-byte symbols and a merge into the end-of-word form
+const char kMerges[] = "#version: 0.2\n"
+                       "t h\n"
+                       "th e</w>\n"
+                       "e r\n"
+                       "i n\n"
+                       "in g</w>\n"
+                       "l o\n"
+                       "lo w\n"
+                       "low er</w>\n"
+                       "a a\n"
+                       "aa a</w>\n"
+                       "a n\n"
+                       "an d</w>\n"
+                       "e r\n"
+                       "\xC3\xBC b\n"
+                       "\xC3\xBC" "b er</w>\n"
+                       "w i\n";
+
+const char *const kSentences[] = {
+    "the lower thing and the rest.",
+    "\xC3\x9C" "ber aaa, aaaa and aa!",
+    "\xC3\xBC" "ber the wing (lowering) winning",
+    "t h e low, lower lowest",
+    "It costs $1,000.50 - really?",
+};
+
+void WriteFile(const std::string &path, const std::string &contents) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << contents;
+}
+
+// Straightforward BPE on the merges text: merge the lowest-ranked adjacent
+// pair (leftmost on ties) until none is left, then mark the pieces the way
+// LegacyBPETokenizer does
+class ReferenceBpe {
+public:
+  explicit ReferenceBpe(const std::string &merges) {
+    std::istringstream lines(merges);
+    std::string line, left, right;
+    int rank = 0;
+    while (std::getline(lines, line)) {
+      std::istringstream fields(line);
+      if (line.empty() || line[0] == '#' || !(fields >> left >> right)) {
+        continue;
+      }
+      ranks[{left, right}] = rank++;
+    }
+  }
+
+  std::string Encode(const std::string &text) const {
+    std::vector<uint32_t> chars;
+    SplitUtf8(text, chars);
+    std::vector<std::string_view> words;
+    MosesPreTokenize(text, chars, words);
+    std::string pieces;
+    for (std::string_view word : words) {
+      std::vector<std::string> symbols;
+      for (char c : word) {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (symbols.empty() || (byte & 0xC0) != 0x80) {
+          symbols.emplace_back();
+        }
+        symbols.back() += c;
+      }
+      symbols.back() += "</w>";
+      Merge(symbols);
+      for (std::string &symbol : symbols) {
+        const size_t end = symbol.rfind("</w>");
+        symbol = end == std::string::npos ? symbol + "@@"
+                                          : symbol.substr(0, end);
+        pieces += (pieces.empty() ? "" : " ") + symbol;
+      }
+    }
+    return pieces;
+  }
+
+private:
+  void Merge(std::vector<std::string> &symbols) const {
+    for (;;) {
+      size_t best = symbols.size();
+      int best_rank = INT_MAX;
+      for (size_t i = 0; i + 1 < symbols.size(); i++) {
+        const auto it = ranks.find({symbols[i], symbols[i + 1]});
+        if (it != ranks.end() && it->second < best_rank) {
+          best = i;
+          best_rank = it->second;
+        }
+      }
+      if (best == symbols.size()) {
+        return;
+      }
+      symbols[best] += symbols[best + 1];
+      symbols.erase(symbols.begin() + best + 1);
+    }
+  }
+
+  std::map<std::pair<std::string, std::string>, int> ranks;
+};
+
+std::string Pieces(const TokenBuffer &tokens) {
+  std::string pieces;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    pieces += (i ? " " : "") + std::string(tokens.piece(i));
+  }
+  return pieces;
+}
+
+// Words of random letters, so pairs are merged in many orders
+std::vector<std::string> RandomSentences() {
+  const char *const letters[] = {"t", "h", "e", "i", "n", "g", "l",
+                                 "o", "w", "r", "a", "d", "\xC3\xBC", "b"};
+  std::mt19937 rng(7);
+  std::vector<std::string> sentences;
+  for (int i = 0; i < 200; i++) {
+    std::string sentence;
+    for (int word = 0; word < 6; word++) {
+      sentence += word ? " " : "";
+      const int length = 1 + static_cast<int>(rng() % 8);
+      for (int c = 0; c < length; c++) {
+        sentence += letters[rng() % 14];
+      }
+    }
+    sentences.push_back(sentence);
+  }
+  return sentences;
+}
+
+} // namespace
+
+TEST(bpe_table_matches_map) {
+  // Small ids in both orders and equal pairs, the cases a XOR of the two
+  // halves would collide on
+  std::vector<std::pair<uint64_t, BpeMerge>> entries;
+  std::unordered_map<uint64_t, BpeMerge> expected;
+  std::mt19937 rng(2024);
+  for (int32_t rank = 0; rank < 5000; rank++) {
+    const int left = static_cast<int>(rng() % 300);
+    const int right = static_cast<int>(rng() % 300);
+    const uint64_t key = BpeRankTable::PairKey(left, right);
+    const BpeMerge merge = {rank, 1000 + rank};
+    entries.emplace_back(key, merge);
+    expected[key] = merge;
+  }
+
+  const auto slots = BpeRankTable::Build(entries);
+  CHECK(slots.size() >= expected.size() * 2);
+  CHECK_EQ(slots.size() & (slots.size() - 1), 0u);
+  BpeRankTable table;
+  CHECK(table.Attach(slots.data(), slots.size()));
+
+  for (int left = 0; left < 300; left++) {
+    for (int right = 0; right < 300; right++) {
+      const uint64_t key = BpeRankTable::PairKey(left, right);
+      const auto it = expected.find(key);
+      BpeMerge merge = {-1, -1};
+      const bool found = table.Find(key, merge);
+      if (found != (it != expected.end()) ||
+          (found && (merge.rank != it->second.rank ||
+                     merge.merged != it->second.merged))) {
+        ReportFailure(__FILE__, __LINE__,
+                      "pair " + std::to_string(left) + "," +
+                          std::to_string(right) + " differs from the map");
+        return;
+      }
+    }
+  }
+}
+
+TEST(bpe_table_later_duplicates_win) {
+  const uint64_t key = BpeRankTable::PairKey(3, 4);
+  const auto slots = BpeRankTable::Build({{key, {7, 70}}, {key, {2, 20}}});
+  BpeRankTable table;
+  CHECK(table.Attach(slots.data(), slots.size()));
+  BpeMerge merge = {};
+  CHECK(table.Find(key, merge));
+  CHECK_EQ(merge.rank, 2);
+  CHECK_EQ(merge.merged, 20);
+  CHECK(!table.Find(BpeRankTable::PairKey(4, 3), merge));
+}
+
+TEST(bpe_table_empty_and_unattached) {
+  BpeRankTable table;
+  BpeMerge merge = {};
+  CHECK(!table.Find(BpeRankTable::PairKey(0, 0), merge));
+
+  const auto slots = BpeRankTable::Build({});
+  CHECK_EQ(slots.size(), 16u);
+  CHECK(table.Attach(slots.data(), slots.size()));
+  CHECK(!table.Find(BpeRankTable::PairKey(0, 0), merge));
+}
+
+TEST(bpe_table_attach_rejects_bad_layout) {
+  const uint64_t key = BpeRankTable::PairKey(1, 2);
+  const auto slots = BpeRankTable::Build({{key, {0, 5}}});
+  BpeRankTable table;
+  CHECK(!table.Attach(slots.data(), 0));
+  CHECK(!table.Attach(slots.data(), slots.size() - 1));
+  const char *bytes = reinterpret_cast<const char *>(slots.data());
+  CHECK(!table.Attach(bytes + 4, slots.size() / 2));
+
+  // A failed attach leaves nothing to look up
+  BpeMerge merge = {};
+  CHECK(!table.Find(key, merge));
+  CHECK(table.Attach(slots.data(), slots.size()));
+  CHECK(table.Find(key, merge));
+}
+
+TEST(bpe_table_full_table_terminates) {
+  // Every slot taken, as in a corrupt file: a miss must still return
+  std::vector<BpeRankTable::Slot> slots(16);
+  for (size_t i = 0; i < slots.size(); i++) {
+    slots[i] = {BpeRankTable::PairKey(1, static_cast<int>(i)), {0, 0}};
+  }
+  BpeRankTable table;
+  CHECK(table.Attach(slots.data(), slots.size()));
+  BpeMerge merge = {};
+  CHECK(!table.Find(BpeRankTable::PairKey(2, 2), merge));
+  CHECK(table.Find(BpeRankTable::PairKey(1, 15), merge));
+}
+
+TEST(bpe_tokenizer_matches_reference) {
+  const std::string dir = MakeTempDir();
+  const std::string merges_path = dir + "/bpe.model";
+  WriteFile(merges_path, kMerges);
+  const ReferenceBpe reference(kMerges);
+  std::vector<std::string> sentences = RandomSentences();
+  sentences.insert(sentences.end(), std::begin(kSentences),
+                   std::end(kSentences));
+
+  // The first load compiles <merges>.bin, the second maps it, and the third
+  // starts from the word cache the first two saved
+  std::vector<std::vector<int>> compiled_ids;
+  for (int run = 0; run < 3; run++) {
+    LegacyBPETokenizer tokenizer;
+    CHECK(tokenizer.load(merges_path));
+    CHECK(std::filesystem::exists(merges_path + ".bin"));
+    TokenBuffer tokens;
+    for (size_t i = 0; i < sentences.size(); i++) {
+      tokenizer.encode(sentences[i], tokens);
+      CHECK_EQ(Pieces(tokens), reference.Encode(sentences[i]));
+      if (run == 0) {
+        compiled_ids.push_back(tokens.ids());
+      } else if (tokens.ids() != compiled_ids[i]) {
+        ReportFailure(__FILE__, __LINE__,
+                      "ids differ on run " + std::to_string(run) + ": " +
+                          sentences[i]);
+      }
+    }
+  }
+  CHECK(std::filesystem::exists(merges_path + ".cache"));
+  std::filesystem::remove_all(dir);
+}
+
+TEST(bpe_tokenizer_compiled_file_matches_build) {
+  const std::string dir = MakeTempDir();
+  const std::string merges_path = dir + "/bpe.model";
+  WriteFile(merges_path, kMerges);
+  std::vector<char> image;
+  CHECK(LegacyBPETokenizer::compile_merges(merges_path, image));
+  CHECK(LegacyBPETokenizer::write_compiled(merges_path + ".bin", image));
+  {
+    LegacyBPETokenizer tokenizer;
+    CHECK(tokenizer.load(merges_path));
+  }
+  // Loading maps the file as written instead of rebuilding it
+  std::ifstream file(merges_path + ".bin", std::ios::binary);
+  const std::vector<char> written((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+  CHECK(written == image);
+  CHECK(!LegacyBPETokenizer::compile_merges(dir + "/missing", image));
+  std::filesystem::remove_all(dir);
+}
+
+TEST(bpe_tokenizer_rebuilds_stale_tables) {
+  const std::string dir = MakeTempDir();
+  const std::string merges_path = dir + "/bpe.model";
+  WriteFile(merges_path, kMerges);
+  const std::string sentence = "the wing and winning";
+  {
+    LegacyBPETokenizer tokenizer;
+    CHECK(tokenizer.load(merges_path));
+    TokenBuffer tokens;
+    tokenizer.encode(sentence, tokens);
+    CHECK_EQ(Pieces(tokens), "the w@@ ing and w@@ in@@ n@@ ing");
+  }
+
+  // Changed merges: neither the old .bin nor the old word cache applies
+  const std::string changed = std::string(kMerges) + "w ing</w>\n";
+  WriteFile(merges_path, changed);
+  LegacyBPETokenizer tokenizer;
+  CHECK(tokenizer.load(merges_path));
+  TokenBuffer tokens;
+  tokenizer.encode(sentence, tokens);
+  CHECK_EQ(Pieces(tokens), ReferenceBpe(changed).Encode(sentence));
+  CHECK_EQ(Pieces(tokens), "the wing and w@@ in@@ n@@ ing");
+  std::filesystem::remove_all(dir);
+}
+
+TEST(bpe_tokenizer_decode_round_trips) {
+  const std::string dir = MakeTempDir();
+  const std::string merges_path = dir + "/bpe.model";
+  WriteFile(merges_path, kMerges);
+  LegacyBPETokenizer tokenizer;
+  CHECK(tokenizer.load(merges_path));
+  TokenBuffer tokens;
+  for (const char *sentence : kSentences) {
+    tokenizer.encode(sentence, tokens);
+    std::string text = "> ";
+    tokenizer.decode(tokens, text);
+    CHECK_EQ(text, "> " + std::string(sentence));
+  }
+  std::filesystem::remove_all(dir);
+}
+
+TEST(bpe_tokenizer_concurrent_cache_saves) {
+  const std::string dir = MakeTempDir();
+  const std::string merges_path = dir + "/bpe.model";
+  WriteFile(merges_path, kMerges);
+  const std::vector<std::string> sentences = RandomSentences();
+  {
+    LegacyBPETokenizer compile;
+    CHECK(compile.load(merges_path));
+  }
+
+  // Tokenizers that learned different words save their caches at once
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; t++) {
+    threads.emplace_back([&, t] {
+      LegacyBPETokenizer tokenizer;
+      tokenizer.load(merges_path);
+      TokenBuffer tokens;
+      for (size_t i = t; i < sentences.size(); i += 4) {
+        tokenizer.encode(sentences[i], tokens);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Whichever cache won is whole, and no temporary file is left behind
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    CHECK(entry.path().string().find(".tmp") == std::string::npos);
+  }
+  const ReferenceBpe reference(kMerges);
+  LegacyBPETokenizer tokenizer;
+  CHECK(tokenizer.load(merges_path));
+  TokenBuffer tokens;
+  for (const std::string &sentence : sentences) {
+    tokenizer.encode(sentence, tokens);
+    CHECK_EQ(Pieces(tokens), reference.Encode(sentence));
+  }
+  std::filesystem::remove_all(dir);
+}
+
+TEST(bpe_tokenizer_concurrent_compiles) {
+  // First loads after an install race to compile the same table
+  const std::string dir = MakeTempDir();
+  const std::string merges_path = dir + "/bpe.model";
+  WriteFile(merges_path, kMerges);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&] {
+      std::vector<char> image;
+      if (LegacyBPETokenizer::compile_merges(merges_path, image)) {
+        LegacyBPETokenizer::write_compiled(merges_path + ".bin", image);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    CHECK(entry.path().string().find(".tmp") == std::string::npos);
+  }
+  std::vector<char> image;
+  CHECK(LegacyBPETokenizer::compile_merges(merges_path, image));
+  std::ifstream file(merges_path + ".bin", std::ios::binary);
+  const std::vector<char> written((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+  CHECK(written == image);
+  std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,122 @@
+#include "batch_scheduler.h"
+#include "cancellation.h"
+#include "mock_chain.h"
+#include "mock_translator.h"
+#include "test.h"
+#include <atomic>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+// MockTranslator that takes 20 ms per token and counts decoded segments
+class SlowTranslator : public MockTranslator {
+public:
+  SlowTranslator() : MockTranslator(Options()) {}
+
+  std::vector<std::vector<std::string>>
+  translate_tokens(const std::vector<std::vector<std::string>> &batch,
+                   const std::vector<const CancellationToken *> &cancel =
+                       {}) override {
+    decoded += batch.size();
+    return MockTranslator::translate_tokens(batch, cancel);
+  }
+
+  std::atomic<size_t> decoded{0};
+
+private:
+  static MockTranslatorOptions Options() {
+    MockTranslatorOptions options;
+    options.step_latency = milliseconds(20);
+    return options;
+  }
+};
+
+std::vector<std::string> Words(size_t count) {
+  return std::vector<std::string>(count, "word");
+}
+
+} // namespace
+
+TEST(cancel_token_expires_at_deadline) {
+  CancellationToken token;
+  CHECK(!token.IsCancelled());
+  token.SetDeadline(milliseconds(30));
+  CHECK(!token.IsCancelled());
+  std::this_thread::sleep_for(milliseconds(50));
+  CHECK(token.IsCancelled());
+  CHECK(token.DeadlinePassed());
+
+  CancellationToken cancelled;
+  cancelled.Cancel();
+  CHECK(cancelled.IsCancelled());
+  CHECK(!cancelled.DeadlinePassed());
+}
+
+TEST(cancel_mid_decode_keeps_partial_output) {
+  auto model = std::make_shared<SlowTranslator>();
+  BatchSchedulerOptions options;
+  options.window = milliseconds(50);
+  BatchScheduler scheduler(model, "test", options);
+
+  // Both requests share one batch, decoded from 50 ms on; the one with a
+  // deadline stops at 100 ms while the other runs to its end at 150 ms
+  auto cancel = std::make_shared<CancellationToken>();
+  cancel->SetDeadline(milliseconds(100));
+  auto full = scheduler.Submit({Words(5)});
+  const auto partial = scheduler.TranslateTokens({Words(10)}, cancel);
+  CHECK_EQ(partial.size(), 1u);
+  CHECK(!partial[0].empty() && partial[0].size() < 5);
+  CHECK_EQ(full.get()[0].size(), 5u);
+  CHECK_EQ(model->decoded.load(), 2u);
+}
+
+TEST(cancel_queued_request_returns_without_decoding) {
+  auto model = std::make_shared<SlowTranslator>();
+  BatchSchedulerOptions options;
+  options.window = milliseconds(0);
+  BatchScheduler scheduler(model, "test", options);
+
+  // The first request keeps the model busy for 400 ms
+  auto busy = scheduler.Submit({Words(20)});
+  std::this_thread::sleep_for(milliseconds(20));
+
+  auto cancel = std::make_shared<CancellationToken>();
+  cancel->SetDeadline(milliseconds(50));
+  const auto start = Clock::now();
+  const auto outputs = scheduler.TranslateTokens({Words(3), Words(3)}, cancel);
+  CHECK(Clock::now() - start < milliseconds(300));
+  CHECK_EQ(outputs.size(), 2u);
+  CHECK(outputs[0].empty() && outputs[1].empty());
+
+  // The worker skips the abandoned request once it is free
+  CHECK_EQ(busy.get()[0].size(), 20u);
+  auto after = scheduler.Submit({Words(1)});
+  after.get();
+  CHECK_EQ(model->decoded.load(), 2u);
+}
+
+TEST(cancel_chain_reports_deadline_and_cancel) {
+  TranslationChain chain;
+  CHECK(LoadMockChain(chain, {"de", "en"}));
+
+  auto expired = std::make_shared<CancellationToken>();
+  expired->SetDeadline(milliseconds(0));
+  auto outputs = chain.TranslateBatch({"Hallo", "Welt"}, expired);
+  CHECK(chain.WasCancelled());
+  CHECK_EQ(chain.GetError(), "Translation deadline exceeded");
+  CHECK(outputs == (std::vector<std::string>{"", ""}));
+
+  auto cancelled = std::make_shared<CancellationToken>();
+  cancelled->Cancel();
+  chain.TranslateBatch({"Hallo"}, cancelled);
+  CHECK(chain.WasCancelled());
+  CHECK_EQ(chain.GetError(), "Translation cancelled");
+
+  // A later call without cancellation starts clean
+  CHECK(!chain.Translate("Hallo").empty());
+  CHECK(!chain.WasCancelled());
+  CHECK_EQ(chain.GetError(), "");
+}
@@ -0,0 +1,50 @@
+#include "mock_chain.h"
+#include "test.h"
+#include "translation_memory.h"
+#include <algorithm>
+
+TEST(chain_memory_of_a_token_passing_hop_is_used) {
+  TranslationChain first_hop;
+  CHECK(LoadMockChain(first_hop, {"de", "en"}));
+  const std::string english = first_hop.Translate("Guten Tag");
+
+  size_t total = 0;
+  CHECK(TranslationMemory::Import(TranslationMemory::GetPath("en", "es"),
+                                  {{english, "Buenos dias"}}, total));
+  CHECK_EQ(total, 1u);
+
+  // de_en and en_es share a tokenizer; the memory still applies to hop 2
+  TranslationChain chain;
+  CHECK(LoadMockChain(chain, {"de", "en", "es"}));
+  TakeMockSegments();
+  const std::vector<std::string> outputs =
+      chain.TranslateBatch({"Guten Tag", "Gute Nacht"});
+  CHECK_EQ(chain.GetError(), "");
+  CHECK_EQ(outputs.size(), 2u);
+  CHECK_EQ(outputs[0], "Buenos dias");
+  CHECK(outputs[1] != "Buenos dias" && !outputs[1].empty());
+
+  // Hop 1 decodes both segments, hop 2 only the one not remembered
+  const std::vector<std::string> sent = TakeMockSegments();
+  CHECK_EQ(sent.size(), 3u);
+  CHECK_EQ(std::count(sent.begin(), sent.end(), english), 0);
+}
+
+TEST(chain_duplicates_are_decoded_once) {
+  TranslationChain chain;
+  CHECK(LoadMockChain(chain, {"de", "en"}));
+  TakeMockSegments();
+  // Whitespace differences do not make a segment distinct
+  const std::vector<std::string> outputs = chain.TranslateBatch(
+      {"Ja bitte", "Nein", "  Ja   bitte ", "Ja bitte", "Nein"});
+  std::vector<std::string> sent = TakeMockSegments();
+  std::sort(sent.begin(), sent.end());
+  CHECK(sent == (std::vector<std::string>{"Ja bitte", "Nein"}));
+
+  CHECK_EQ(outputs.size(), 5u);
+  CHECK_EQ(outputs[0], chain.Translate("Ja bitte"));
+  CHECK_EQ(outputs[1], chain.Translate("Nein"));
+  CHECK_EQ(outputs[2], outputs[0]);
+  CHECK_EQ(outputs[3], outputs[0]);
+  CHECK_EQ(outputs[4], outputs[1]);
+}
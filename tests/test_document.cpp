@@ -0,0 +1,130 @@
+#include "document_translator.h"
+#include "mock_chain.h"
+#include "test.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+void WriteFile(const std::string &path, const std::string &contents) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << contents;
+}
+
+std::string ReadFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+const char kDocument[] = "First line here.\n"
+                         "  Second line, indented.\n"
+                         "\n"
+                         "Third line. It has two sentences.\n"
+                         "Fourth line broken here.\n"
+                         "Fifth and last line.\n";
+
+DocumentOptions SmallBatches() {
+  DocumentOptions options;
+  options.batch_segments = 2;
+  return options;
+}
+
+} // namespace
+
+TEST(document_translates_in_order) {
+  TranslationChain chain;
+  CHECK(LoadMockChain(chain, {"de", "en"}));
+  const std::string dir = MakeTempDir();
+  WriteFile(dir + "/in.txt", kDocument);
+  CHECK(TranslateDocument(dir + "/in.txt", dir + "/out.txt", chain,
+                          SmallBatches()));
+
+  std::string expected;
+  std::istringstream lines(kDocument);
+  std::string line;
+  while (std::getline(lines, line)) {
+    const size_t begin = line.find_first_not_of(' ');
+    if (begin != std::string::npos) {
+      line = line.substr(0, begin) + chain.Translate(line.substr(begin));
+    }
+    expected += line + "\n";
+  }
+  CHECK_EQ(ReadFile(dir + "/out.txt"), expected);
+  CHECK(!std::filesystem::exists(GetDocumentCheckpointPath(dir + "/out.txt")));
+}
+
+TEST(document_failed_batch_is_retried_on_resume) {
+  TranslationChain chain;
+  CHECK(LoadMockChain(chain, {"de", "en"}));
+  const std::string dir = MakeTempDir();
+  WriteFile(dir + "/in.txt", kDocument);
+  CHECK(TranslateDocument(dir + "/in.txt", dir + "/full.txt", chain,
+                          SmallBatches()));
+
+  // The batch holding "broken" fails: nothing of it is written or
+  // checkpointed, so the rerun translates it instead of skipping it
+  SetMockFailure("broken");
+  CHECK(!TranslateDocument(dir + "/in.txt", dir + "/out.txt", chain,
+                           SmallBatches()));
+  SetMockFailure("");
+  CHECK(std::filesystem::exists(GetDocumentCheckpointPath(dir + "/out.txt")));
+  const std::string partial = ReadFile(dir + "/out.txt");
+  CHECK(partial.size() < ReadFile(dir + "/full.txt").size());
+  CHECK(ReadFile(dir + "/full.txt").rfind(partial, 0) == 0);
+
+  TakeMockSegments();
+  CHECK(TranslateDocument(dir + "/in.txt", dir + "/out.txt", chain,
+                          SmallBatches()));
+  CHECK_EQ(ReadFile(dir + "/out.txt"), ReadFile(dir + "/full.txt"));
+  // Only the failed batch and the rest are decoded again
+  const std::vector<std::string> resumed = TakeMockSegments();
+  CHECK(!resumed.empty());
+  CHECK(resumed.size() < 6);
+}
+
+TEST(document_keeps_line_endings) {
+  TranslationChain chain;
+  CHECK(LoadMockChain(chain, {"de", "en"}));
+  const std::string dir = MakeTempDir();
+  // CRLF lines, a blank CRLF line, an LF line and no final line ending
+  WriteFile(dir + "/in.txt",
+            "Hello there.\r\n\r\n  Good day.\r\nPlain line.\nLast one.");
+  CHECK(TranslateDocument(dir + "/in.txt", dir + "/out.txt", chain,
+                          SmallBatches()));
+  CHECK_EQ(ReadFile(dir + "/out.txt"),
+           chain.Translate("Hello there.") + "\r\n\r\n  " +
+               chain.Translate("Good day.") + "\r\n" +
+               chain.Translate("Plain line.") + "\n" +
+               chain.Translate("Last one."));
+}
+
+TEST(document_edited_input_starts_over) {
+  TranslationChain chain;
+  CHECK(LoadMockChain(chain, {"de", "en"}));
+  const std::string dir = MakeTempDir();
+  WriteFile(dir + "/in.txt", kDocument);
+  SetMockFailure("broken");
+  CHECK(!TranslateDocument(dir + "/in.txt", dir + "/out.txt", chain,
+                           SmallBatches()));
+  SetMockFailure("");
+  CHECK(std::filesystem::exists(GetDocumentCheckpointPath(dir + "/out.txt")));
+
+  // Same size, other text: the checkpoint offsets no longer apply
+  std::string edited = kDocument;
+  edited.replace(0, 5, "Early");
+  WriteFile(dir + "/in.txt", edited);
+  const auto mtime = std::filesystem::last_write_time(dir + "/in.txt");
+  std::filesystem::last_write_time(dir + "/in.txt",
+                                   mtime + std::chrono::hours(1));
+  CHECK(TranslateDocument(dir + "/in.txt", dir + "/out.txt", chain,
+                          SmallBatches()));
+
+  WriteFile(dir + "/fresh.txt", edited);
+  CHECK(TranslateDocument(dir + "/fresh.txt", dir + "/full.txt", chain,
+                          SmallBatches()));
+  CHECK_EQ(ReadFile(dir + "/out.txt"), ReadFile(dir + "/full.txt"));
+}
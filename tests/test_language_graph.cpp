@@ -0,0 +1,78 @@
+#include "language_graph.h"
+#include "package_stats.h"
+#include "test.h"
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+// A package directory with a model.bin of the given size (sparse)
+void MakePackage(const std::string &packages_dir, const std::string &name,
+                 uintmax_t model_bytes = 0) {
+  const std::string model_dir = packages_dir + "/" + name + "/model";
+  std::filesystem::create_directories(model_dir);
+  std::ofstream(model_dir + "/model.bin").close();
+  std::filesystem::resize_file(model_dir + "/model.bin", model_bytes);
+}
+
+// Store a measured load time and 1 ms per token for package
+void Measure(const std::string &package, double load_ms) {
+  PackageStats &stats = PackageStats::GetInstance();
+  stats.SetRecording(true);
+  stats.RecordLoad(package, load_ms);
+  stats.RecordDecode(package, 1, 10, 10);
+  stats.SetRecording(false); // Never save test timings
+}
+
+using Path = std::vector<std::string>;
+
+} // namespace
+
+TEST(routing_prefers_measured_fast_hops) {
+  const std::string dir = MakeTempDir();
+  MakePackage(dir, "translate-ra_rc-direct");
+  MakePackage(dir, "translate-ra_rb-hop");
+  MakePackage(dir, "translate-rb_rc-hop");
+  Measure("translate-ra_rc-direct", 5000);
+  Measure("translate-ra_rb-hop", 100);
+  Measure("translate-rb_rc-hop", 100);
+
+  LanguageGraph graph;
+  graph.BuildFromPackages(dir);
+  CHECK(graph.FindPath("ra", "rc") == (Path{"ra", "rb", "rc"}));
+  CHECK(graph.FindPath("ra", "rb") == (Path{"ra", "rb"}));
+  CHECK(graph.FindPath("ra", "ra") == Path{"ra"});
+  CHECK(graph.FindPath("rc", "ra").empty());
+}
+
+TEST(routing_estimates_unmeasured_packages_from_model_size) {
+  const std::string dir = MakeTempDir();
+  MakePackage(dir, "translate-sa_sc-big", 500 << 20);
+  MakePackage(dir, "translate-sa_sb-small", 10 << 20);
+  MakePackage(dir, "translate-sb_sc-small", 10 << 20);
+
+  LanguageGraph graph;
+  graph.BuildFromPackages(dir);
+  CHECK(graph.FindPath("sa", "sc") == (Path{"sa", "sb", "sc"}));
+
+  // Equal sizes: the direct package costs half as much
+  std::filesystem::resize_file(dir + "/translate-sa_sc-big/model/model.bin",
+                               10 << 20);
+  CHECK(graph.FindPath("sa", "sc") == (Path{"sa", "sc"}));
+}
+
+TEST(routing_cached_packages_cost_no_load) {
+  const std::string dir = MakeTempDir();
+  MakePackage(dir, "translate-ta_tc-direct");
+  MakePackage(dir, "translate-ta_tb-hop");
+  MakePackage(dir, "translate-tb_tc-hop");
+  Measure("translate-ta_tc-direct", 500);
+  Measure("translate-ta_tb-hop", 300);
+  Measure("translate-tb_tc-hop", 300);
+
+  LanguageGraph graph;
+  graph.BuildFromPackages(dir);
+  CHECK(graph.FindPath("ta", "tc") == (Path{"ta", "tc"}));
+  graph.SetCachedPackages({"translate-ta_tb-hop", "translate-tb_tc-hop"});
+  CHECK(graph.FindPath("ta", "tc") == (Path{"ta", "tb", "tc"}));
+}
@@ -0,0 +1,51 @@
+#include "test.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+static int failures = 0;
+
+std::vector<TestCase> &TestRegistry() {
+  static std::vector<TestCase> tests;
+  return tests;
+}
+
+void ReportFailure(const char *file, int line, const std::string &message) {
+  std::cerr << file << ":" << line << ": FAILED " << message << std::endl;
+  failures++;
+}
+
+std::string MakeTempDir() {
+  static std::atomic<int> counter{0};
+  const auto stamp =
+      std::chrono::steady_clock::now().time_since_epoch().count();
+  std::filesystem::path dir =
+      std::filesystem::temp_directory_path() /
+      ("fast-translator-test-" + std::to_string(stamp) + "-" +
+       std::to_string(counter++));
+  std::filesystem::create_directories(dir);
+  return dir.string();
+}
+
+// Fast_translator_tests [prefix]: run the tests whose name starts with
+// prefix (all of them without one)
+int main(int argc, char *argv[]) {
+  const std::string prefix = argc > 1 ? argv[1] : "";
+  int run = 0;
+  for (const auto &test : TestRegistry()) {
+    if (std::string(test.name).rfind(prefix, 0) != 0) {
+      continue;
+    }
+    const int before = failures;
+    test.run();
+    std::cerr << (failures == before ? "[ OK ] " : "[FAIL] ") << test.name
+              << std::endl;
+    run++;
+  }
+  if (run == 0) {
+    std::cerr << "No tests match '" << prefix << "'" << std::endl;
+    return 1;
+  }
+  return failures == 0 ? 0 : 1;
+}
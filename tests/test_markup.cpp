@@ -0,0 +1,125 @@
+#include "markup_translator.h"
+#include "mock_chain.h"
+#include "test.h"
+
+namespace {
+
+const char kMarkdown[] = "# Getting started\n"
+                         "\n"
+                         "Install the **latest** release from "
+                         "https://example.com/download and run `make`.\n"
+                         "\n"
+                         "```sh\n"
+                         "make install\n"
+                         "```\n"
+                         "\n"
+                         "- First item\n"
+                         "- Second [link](https://example.com/a) here\n";
+
+const char kHtml[] = "<!DOCTYPE html>\n"
+                     "<p class=\"intro\">Hello <b>brave</b> world &amp; "
+                     "friends</p>\n"
+                     "<!-- a comment -->\n"
+                     "<pre>keep   this</pre>\n"
+                     "<script>var x = \"text\";</script>\n"
+                     "<a href=\"https://example.com\">Read more</a>\n";
+
+std::string Concatenate(const std::vector<MarkupPiece> &pieces) {
+  std::string text;
+  for (const MarkupPiece &piece : pieces) {
+    text += piece.text;
+  }
+  return text;
+}
+
+// Every markup run of text must appear in translated, in order
+void CheckMarkupKept(const std::string &text, MarkupFormat format,
+                     const std::string &translated) {
+  size_t pos = 0;
+  for (const MarkupPiece &piece : SplitMarkup(text, format)) {
+    if (piece.translate) {
+      continue;
+    }
+    const size_t found = translated.find(piece.text, pos);
+    if (found == std::string::npos) {
+      ReportFailure(__FILE__, __LINE__,
+                    "markup [" + piece.text + "] lost in [" + translated +
+                        "]");
+      return;
+    }
+    pos = found + piece.text.size();
+  }
+}
+
+} // namespace
+
+TEST(markup_split_concatenates_to_input) {
+  const struct {
+    const char *text;
+    MarkupFormat format;
+  } cases[] = {
+      {kMarkdown, MarkupFormat::Markdown},
+      {kHtml, MarkupFormat::Html},
+      {"Plain text with https://example.com/x inside.", MarkupFormat::Plain},
+      {"", MarkupFormat::Html},
+      {"<b>unclosed", MarkupFormat::Html},
+      {"`open code span", MarkupFormat::Markdown},
+  };
+  for (const auto &c : cases) {
+    CHECK_EQ(Concatenate(SplitMarkup(c.text, c.format)), std::string(c.text));
+  }
+}
+
+TEST(markup_split_marks_code_and_urls) {
+  for (const MarkupPiece &piece :
+       SplitMarkup(kMarkdown, MarkupFormat::Markdown)) {
+    if (piece.translate &&
+        (piece.text.find("make") != std::string::npos ||
+         piece.text.find("https://") != std::string::npos ||
+         piece.text.find("**") != std::string::npos)) {
+      ReportFailure(__FILE__, __LINE__, "translatable: " + piece.text);
+    }
+  }
+  for (const MarkupPiece &piece : SplitMarkup(kHtml, MarkupFormat::Html)) {
+    if (piece.translate && (piece.text.find('<') != std::string::npos ||
+                            piece.text.find("keep") != std::string::npos ||
+                            piece.text.find("var x") != std::string::npos)) {
+      ReportFailure(__FILE__, __LINE__, "translatable: " + piece.text);
+    }
+  }
+}
+
+TEST(markup_translate_keeps_markup) {
+  TranslationChain chain;
+  CHECK(LoadMockChain(chain, {"de", "en"}));
+  for (const auto &[text, format] :
+       {std::make_pair(kMarkdown, MarkupFormat::Markdown),
+        std::make_pair(kHtml, MarkupFormat::Html)}) {
+    const std::string translated = TranslateMarkup(text, format, chain);
+    CHECK(translated != text);
+    CheckMarkupKept(text, format, translated);
+  }
+}
+
+TEST(markup_translate_runs_between_tags) {
+  TranslationChain chain;
+  CHECK(LoadMockChain(chain, {"de", "en"}));
+  // Each run is translated on its own, keeping the spaces around it
+  CHECK_EQ(TranslateMarkup("Hello <b>brave</b> world", MarkupFormat::Html,
+                           chain),
+           chain.Translate("Hello") + " <b>" + chain.Translate("brave") +
+               "</b> " + chain.Translate("world"));
+  // Entities are decoded for the model and escaped again afterwards
+  std::string escaped;
+  for (char c : chain.Translate("Tom & Jerry")) {
+    escaped += c == '&' ? std::string("&amp;") : std::string(1, c);
+  }
+  CHECK_EQ(TranslateMarkup("<p>Tom &amp; Jerry</p>", MarkupFormat::Html,
+                           chain),
+           "<p>" + escaped + "</p>");
+  CHECK_EQ(TranslateMarkup("<p>1 &lt; 2</p>", MarkupFormat::Html, chain),
+           "<p>1 &lt; 2</p>");
+  // Runs without letters are not sent to the model
+  CHECK_EQ(TranslateMarkup("**42** `x`", MarkupFormat::Markdown, chain),
+           "**42** `x`");
+}
@@ -0,0 +1,217 @@
+#include "model_quantizer.h"
+#include "test.h"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// model.bin fields in host byte order, as CTranslate2 writes them
+class ModelWriter {
+public:
+  template <typename T> void Put(T value) {
+    bytes.append(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  void PutString(const std::string &text) {
+    Put<uint16_t>(static_cast<uint16_t>(text.size() + 1));
+    bytes.append(text.c_str(), text.size() + 1);
+  }
+
+  template <typename T>
+  void PutVariable(const std::string &name, std::vector<uint32_t> dims,
+                   uint8_t dtype, const std::vector<T> &values) {
+    PutString(name);
+    Put<uint8_t>(static_cast<uint8_t>(dims.size()));
+    for (uint32_t dim : dims) {
+      Put(dim);
+    }
+    Put(dtype);
+    Put<uint32_t>(static_cast<uint32_t>(values.size() * sizeof(T)));
+    bytes.append(reinterpret_cast<const char *>(values.data()),
+                 values.size() * sizeof(T));
+  }
+
+  std::string bytes;
+};
+
+class ModelReader {
+public:
+  explicit ModelReader(std::string bytes) : bytes(std::move(bytes)) {}
+
+  template <typename T> T Get() {
+    T value{};
+    if (pos + sizeof(T) <= bytes.size()) {
+      std::memcpy(&value, bytes.data() + pos, sizeof(T));
+    }
+    pos += sizeof(T);
+    return value;
+  }
+
+  std::string GetString() {
+    const uint16_t length = Get<uint16_t>();
+    std::string text = bytes.substr(pos, length > 0 ? length - 1 : 0);
+    pos += length;
+    return text;
+  }
+
+  struct Variable {
+    std::string name;
+    std::vector<uint32_t> dims;
+    uint8_t dtype = 0;
+    std::string data;
+  };
+
+  Variable GetVariable() {
+    Variable variable;
+    variable.name = GetString();
+    variable.dims.resize(Get<uint8_t>());
+    for (auto &dim : variable.dims) {
+      dim = Get<uint32_t>();
+    }
+    variable.dtype = Get<uint8_t>();
+    const uint32_t size = Get<uint32_t>();
+    variable.data = bytes.substr(pos, size);
+    pos += size;
+    return variable;
+  }
+
+  std::string Rest() { return pos < bytes.size() ? bytes.substr(pos) : ""; }
+
+private:
+  std::string bytes;
+  size_t pos = 0;
+};
+
+template <typename T> std::vector<T> Values(const std::string &data) {
+  std::vector<T> values(data.size() / sizeof(T));
+  std::memcpy(values.data(), data.data(), values.size() * sizeof(T));
+  return values;
+}
+
+std::string ReadFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+const uint8_t kFloat32 = 0;
+const uint8_t kInt8 = 1;
+const uint8_t kFloat16 = 4;
+
+// A float32 and a float16 weight, two variables that stay as they are, two
+// aliases and bytes a newer format appends after the aliases
+std::string SampleModel() {
+  ModelWriter model;
+  model.Put<uint32_t>(6);
+  model.PutString("TransformerSpec");
+  model.Put<uint32_t>(7);
+  model.Put<uint32_t>(4);
+  model.PutVariable<float>("encoder/embeddings/weight", {2, 3}, kFloat32,
+                           {1.0f, -2.0f, 0.5f, 0.0f, 0.0f, 0.0f});
+  model.PutVariable<float>("encoder/bias", {3}, kFloat32, {1, 2, 3});
+  // 1.0, -0.5, 2.0, 0.0 as IEEE half floats
+  model.PutVariable<uint16_t>("decoder/layer_0/weight", {2, 2}, kFloat16,
+                              {0x3C00, 0xB800, 0x4000, 0x0000});
+  model.PutVariable<float>("decoder/norm_weight", {1, 2}, kFloat32, {4, 5});
+  model.Put<uint32_t>(2);
+  model.PutString("decoder/embeddings/weight");
+  model.PutString("encoder/embeddings/weight");
+  model.PutString("decoder/bias");
+  model.PutString("encoder/bias");
+  model.bytes += "TAIL";
+  return model.bytes;
+}
+
+} // namespace
+
+TEST(quantize_rewrites_weights_and_aliases) {
+  const std::string dir = MakeTempDir();
+  const std::string original = SampleModel();
+  std::ofstream(dir + "/model.bin", std::ios::binary) << original;
+
+  QuantizeStats stats;
+  CHECK(QuantizeModelToInt8(dir, &stats));
+  CHECK_EQ(stats.quantized_variables, 2u);
+  CHECK_EQ(stats.bytes_before, original.size());
+
+  ModelReader model(ReadFile(dir + "/model.bin"));
+  CHECK_EQ(model.Get<uint32_t>(), 6u);
+  CHECK_EQ(model.GetString(), "TransformerSpec");
+  CHECK_EQ(model.Get<uint32_t>(), 7u);
+  CHECK_EQ(model.Get<uint32_t>(), 6u); // Two scales added
+
+  // Rows are scaled by 127 / max|row|; an all-zero row keeps scale 1
+  auto weight = model.GetVariable();
+  CHECK_EQ(weight.name, "encoder/embeddings/weight");
+  CHECK(weight.dims == (std::vector<uint32_t>{2, 3}));
+  CHECK_EQ(weight.dtype, kInt8);
+  CHECK(Values<int8_t>(weight.data) ==
+        (std::vector<int8_t>{64, -127, 32, 0, 0, 0}));
+  auto scale = model.GetVariable();
+  CHECK_EQ(scale.name, "encoder/embeddings/weight_scale");
+  CHECK(scale.dims == std::vector<uint32_t>{2});
+  CHECK_EQ(scale.dtype, kFloat32);
+  CHECK(Values<float>(scale.data) == (std::vector<float>{63.5f, 1.0f}));
+
+  auto bias = model.GetVariable();
+  CHECK_EQ(bias.name, "encoder/bias");
+  CHECK_EQ(bias.dtype, kFloat32);
+  CHECK(Values<float>(bias.data) == (std::vector<float>{1, 2, 3}));
+
+  auto half = model.GetVariable();
+  CHECK_EQ(half.name, "decoder/layer_0/weight");
+  CHECK_EQ(half.dtype, kInt8);
+  CHECK(Values<int8_t>(half.data) == (std::vector<int8_t>{127, -64, 127, 0}));
+  auto half_scale = model.GetVariable();
+  CHECK_EQ(half_scale.name, "decoder/layer_0/weight_scale");
+  CHECK(Values<float>(half_scale.data) == (std::vector<float>{127.0f, 63.5f}));
+
+  // Not a "<scope>/weight" matrix
+  auto norm = model.GetVariable();
+  CHECK_EQ(norm.name, "decoder/norm_weight");
+  CHECK_EQ(norm.dtype, kFloat32);
+
+  // The tied embedding gets its scale aliased too
+  CHECK_EQ(model.Get<uint32_t>(), 3u);
+  CHECK_EQ(model.GetString(), "decoder/embeddings/weight_scale");
+  CHECK_EQ(model.GetString(), "encoder/embeddings/weight_scale");
+  CHECK_EQ(model.GetString(), "decoder/embeddings/weight");
+  CHECK_EQ(model.GetString(), "encoder/embeddings/weight");
+  CHECK_EQ(model.GetString(), "decoder/bias");
+  CHECK_EQ(model.GetString(), "encoder/bias");
+  CHECK_EQ(model.Rest(), "TAIL");
+
+  // A second run finds nothing left to convert
+  const std::string quantized = ReadFile(dir + "/model.bin");
+  CHECK(QuantizeModelToInt8(dir, &stats));
+  CHECK_EQ(stats.quantized_variables, 0u);
+  CHECK(ReadFile(dir + "/model.bin") == quantized);
+}
+
+TEST(quantize_keeps_the_original_on_error) {
+  const std::string dir = MakeTempDir();
+  const std::string cut = SampleModel().substr(0, 60);
+  std::ofstream(dir + "/model.bin", std::ios::binary) << cut;
+  CHECK(!QuantizeModelToInt8(dir));
+  CHECK(ReadFile(dir + "/model.bin") == cut);
+
+  ModelWriter old_version;
+  old_version.Put<uint32_t>(3);
+  std::ofstream(dir + "/model.bin", std::ios::binary | std::ios::trunc)
+      << old_version.bytes;
+  CHECK(!QuantizeModelToInt8(dir));
+
+  // No temporary files are left behind
+  size_t files = 0;
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    files += entry.is_regular_file() ? 1 : 0;
+  }
+  CHECK_EQ(files, 1u);
+  CHECK(!QuantizeModelToInt8(dir + "/missing"));
+}
@@ -0,0 +1,100 @@
+#include "moses_tokenizer.h"
+#include "test.h"
+#include "utf8_scan.h"
+
+namespace {
+
+// Tokens of text joined by single spaces, as the BPE tokenizer sees them
+std::string Tokenize(const std::string &text) {
+  std::vector<uint32_t> chars;
+  SplitUtf8(text, chars);
+  std::vector<std::string_view> spans;
+  MosesPreTokenize(text, chars, spans);
+  std::string joined;
+  for (std::string_view span : spans) {
+    if (!joined.empty()) {
+      joined += ' ';
+    }
+    joined.append(span.data(), span.size());
+  }
+  return joined;
+}
+
+std::string Detokenize(const std::string &tokens) {
+  std::string text;
+  MosesDetokenize(tokens, text);
+  return text;
+}
+
+} // namespace
+
+TEST(moses_splits_punctuation) {
+  CHECK_EQ(Tokenize("Hello, world!"), "Hello , world !");
+  CHECK_EQ(Tokenize("(This is a test.)"), "( This is a test . )");
+  CHECK_EQ(Tokenize("Wait... what?!"), "Wait ... what ? !");
+  CHECK_EQ(Tokenize("a/b 50% #tag"), "a / b 50 % # tag");
+  CHECK_EQ(Tokenize("Note: at 10:30"), "Note : at 10 : 30");
+  CHECK_EQ(Tokenize("\xC2\xBFQu\xC3\xA9 tal?"), "\xC2\xBF Qu\xC3\xA9 tal ?");
+  CHECK_EQ(Tokenize("\xC2\xAB" "Bonjour" "\xC2\xBB"),
+           "\xC2\xAB Bonjour \xC2\xBB");
+}
+
+TEST(moses_keeps_words_and_numbers) {
+  CHECK_EQ(Tokenize("don't stop-me"), "don't stop-me");
+  CHECK_EQ(Tokenize("$1,000.50 or 3,5"), "$ 1,000.50 or 3,5");
+  CHECK_EQ(Tokenize("one, two"), "one , two");
+}
+
+TEST(moses_final_periods) {
+  CHECK_EQ(Tokenize("It ends here."), "It ends here .");
+  CHECK_EQ(Tokenize("The U.S. army"), "The U.S. army");
+  CHECK_EQ(Tokenize("met J. Doe"), "met J. Doe");
+  CHECK_EQ(Tokenize("Mr. Smith"), "Mr. Smith");
+  CHECK_EQ(Tokenize("etc. and so on"), "etc. and so on");
+  CHECK_EQ(Tokenize("Ende. Neu"), "Ende . Neu");
+}
+
+TEST(moses_spaces_and_controls_separate) {
+  CHECK_EQ(Tokenize("  a\tb\nc  "), "a b c");
+  CHECK_EQ(Tokenize("a\xC2\xA0" "b"), "a b");
+  CHECK_EQ(Tokenize("a\x01" "b"), "a b");
+  CHECK_EQ(Tokenize(""), "");
+}
+
+TEST(moses_spans_point_into_text) {
+  const std::string text = "Hi, you.";
+  std::vector<uint32_t> chars;
+  SplitUtf8(text, chars);
+  std::vector<std::string_view> spans = {"kept"};
+  MosesPreTokenize(text, chars, spans);
+  CHECK_EQ(spans.size(), 5u);
+  CHECK_EQ(spans[0], "kept");
+  for (size_t i = 1; i < spans.size(); i++) {
+    CHECK(spans[i].data() >= text.data() &&
+          spans[i].data() + spans[i].size() <= text.data() + text.size());
+  }
+}
+
+TEST(moses_detokenize_appends) {
+  std::string text = "> ";
+  MosesDetokenize("a , b", text);
+  CHECK_EQ(text, "> a, b");
+}
+
+TEST(moses_round_trips) {
+  const char *const sentences[] = {
+      "Hello, world! (This is a test.)",
+      "It costs $1,000.50 or 3,5 \xE2\x82\xAC.",
+      "Wait... what?!",
+      "The U.S. army and Mr. Smith met J. Doe.",
+      "He said \"hi\" to me.",
+      "\xC2\xBFQu\xC3\xA9 tal? \xC2\xA1" "Bien!",
+      "\xC2\xAB" "Bonjour\xC2\xBB, dit-il.",
+      "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x80\x81"
+      "\xE3\x83\x86\xE3\x82\xB9\xE3\x83\x88\xE3\x80\x82",
+      "don't stop-me now",
+  };
+  for (const char *sentence : sentences) {
+    CHECK_EQ(Detokenize(Tokenize(sentence)), std::string(sentence));
+  }
+}
@@ -0,0 +1,72 @@
+#include "ollama.h"
+#include "test.h"
+
+namespace {
+
+// Feed body in pieces of size bytes, as curl may split it anywhere
+void FeedInPieces(OllamaStreamParser &parser, const std::string &body,
+                  size_t size) {
+  for (size_t i = 0; i < body.size(); i += size) {
+    const std::string piece = body.substr(i, size);
+    parser.Feed(piece.data(), piece.size());
+  }
+}
+
+} // namespace
+
+TEST(ollama_stream_collects_chunks) {
+  const std::string body = "{\"response\":\"Hel\",\"done\":false}\n"
+                           "{\"response\":\"lo\",\"done\":false}\n"
+                           "{\"response\":\"\",\"done\":true}\n";
+  for (size_t size : {1, 7, 1000}) {
+    std::string streamed;
+    const std::function<void(const std::string &)> on_chunk =
+        [&streamed](const std::string &chunk) { streamed += "|" + chunk; };
+    OllamaStreamParser parser(&on_chunk);
+    FeedInPieces(parser, body, size);
+    std::string error;
+    CHECK(parser.Finish(200, error));
+    CHECK_EQ(parser.Response(), "Hello");
+    CHECK_EQ(streamed, "|Hel|lo");
+    CHECK(error.empty());
+  }
+}
+
+TEST(ollama_stream_last_line_without_newline) {
+  OllamaStreamParser parser;
+  const std::string body = "{\"response\":\"a\"}\n{\"response\":\"b\"}";
+  parser.Feed(body.data(), body.size());
+  std::string error;
+  CHECK(parser.Finish(200, error));
+  CHECK_EQ(parser.Response(), "ab");
+}
+
+TEST(ollama_stream_unterminated_error_body) {
+  // What Ollama sends for an unknown model: one object, no newline
+  OllamaStreamParser parser;
+  const std::string body = "{\"error\":\"model 'x' not found\"}";
+  FeedInPieces(parser, body, 5);
+  CHECK(parser.Response().empty());
+  std::string error;
+  CHECK(!parser.Finish(404, error));
+  CHECK_EQ(error, "model 'x' not found");
+}
+
+TEST(ollama_stream_http_error_without_message) {
+  OllamaStreamParser parser;
+  std::string error;
+  CHECK(!parser.Finish(500, error));
+  CHECK_EQ(error, "Ollama returned HTTP 500");
+
+  OllamaStreamParser empty_ok;
+  CHECK(empty_ok.Finish(200, error));
+}
+
+TEST(ollama_stream_malformed_line) {
+  OllamaStreamParser parser;
+  const std::string body = "{\"response\":\"a\"}\nnot json\n";
+  parser.Feed(body.data(), body.size());
+  std::string error;
+  CHECK(!parser.Finish(200, error));
+  CHECK(error.rfind("Failed to parse Ollama response", 0) == 0);
+}
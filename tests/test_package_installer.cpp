@@ -0,0 +1,124 @@
+#include "package_installer.h"
+#include "test.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+uint32_t Crc32(const std::string &data) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (unsigned char c : data) {
+    crc ^= c;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+void Put16(std::string &out, uint32_t value) {
+  out += static_cast<char>(value & 0xFF);
+  out += static_cast<char>((value >> 8) & 0xFF);
+}
+
+void Put32(std::string &out, uint32_t value) {
+  Put16(out, value & 0xFFFF);
+  Put16(out, value >> 16);
+}
+
+// A zip archive of uncompressed (stored) entries
+void WriteZip(const std::string &path,
+              const std::vector<std::pair<std::string, std::string>> &files) {
+  std::string zip;
+  std::string directory;
+  for (const auto &[name, data] : files) {
+    const uint32_t offset = static_cast<uint32_t>(zip.size());
+    const uint32_t crc = Crc32(data);
+    const uint32_t size = static_cast<uint32_t>(data.size());
+    Put32(zip, 0x04034B50);
+    Put16(zip, 10); // Version needed
+    Put16(zip, 0);  // Flags
+    Put16(zip, 0);  // Stored
+    Put32(zip, 0);  // Time and date
+    Put32(zip, crc);
+    Put32(zip, size);
+    Put32(zip, size);
+    Put16(zip, static_cast<uint32_t>(name.size()));
+    Put16(zip, 0); // Extra field
+    zip += name + data;
+
+    Put32(directory, 0x02014B50);
+    Put16(directory, 10); // Version made by
+    Put16(directory, 10);
+    Put16(directory, 0);
+    Put16(directory, 0);
+    Put32(directory, 0);
+    Put32(directory, crc);
+    Put32(directory, size);
+    Put32(directory, size);
+    Put16(directory, static_cast<uint32_t>(name.size()));
+    Put16(directory, 0); // Extra field
+    Put16(directory, 0); // Comment
+    Put16(directory, 0); // Disk
+    Put16(directory, 0); // Internal attributes
+    Put32(directory, 0); // External attributes
+    Put32(directory, offset);
+    directory += name;
+  }
+  const uint32_t directory_offset = static_cast<uint32_t>(zip.size());
+  zip += directory;
+  Put32(zip, 0x06054B50);
+  Put16(zip, 0);
+  Put16(zip, 0);
+  Put16(zip, static_cast<uint32_t>(files.size()));
+  Put16(zip, static_cast<uint32_t>(files.size()));
+  Put32(zip, static_cast<uint32_t>(directory.size()));
+  Put32(zip, directory_offset);
+  Put16(zip, 0);
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << zip;
+}
+
+std::string ReadFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+} // namespace
+
+TEST(installer_paths_reach_unzip_verbatim) {
+  // Quotes and command substitutions in paths must not reach a shell
+  const std::string dir = MakeTempDir() + "/a \"b\" $(touch pwned) 'c';";
+  std::filesystem::create_directories(dir);
+  const std::string archive = dir + "/pkg `touch pwned`.argosmodel";
+  WriteZip(archive, {{"translate-de_en-1_0/", ""},
+                     {"translate-de_en-1_0/model/model.bin", "weights"}});
+
+  std::string name;
+  std::string error;
+  CHECK(InstallPackageArchive(archive, dir + "/packages", false, name, error));
+  CHECK_EQ(error, "");
+  CHECK_EQ(name, "translate-de_en-1_0");
+  CHECK_EQ(ReadFile(dir + "/packages/translate-de_en-1_0/model/model.bin"),
+           "weights");
+  CHECK(!std::filesystem::exists("pwned"));
+  CHECK(!std::filesystem::exists(dir + "/pwned"));
+}
+
+TEST(installer_rejects_other_files) {
+  const std::string dir = MakeTempDir();
+  std::ofstream(dir + "/not.argosmodel") << "plain text";
+  std::string name;
+  std::string error;
+  CHECK(!InstallPackageArchive(dir + "/not.argosmodel", dir + "/packages",
+                               false, name, error));
+  CHECK(!error.empty());
+  CHECK(!std::filesystem::exists(dir + "/packages/plain text"));
+}
@@ -0,0 +1,122 @@
+#include "mock_chain.h"
+#include "subtitle_translator.h"
+#include "test.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// A subtitle file line by line; text lines are the ones to translate
+struct Line {
+  const char *text;
+  bool translated;
+};
+
+std::vector<std::string> ReadLines(const std::string &path) {
+  std::ifstream file(path);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(file, line)) {
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+// Translate lines as a file named name and check that everything but the
+// text lines comes back byte for byte, with each text line changed
+std::vector<std::string> CheckTranslated(const std::string &name,
+                                         const std::vector<Line> &lines) {
+  TranslationChain chain;
+  CHECK(LoadMockChain(chain, {"de", "en"}));
+  const std::string dir = MakeTempDir();
+  const std::string input = dir + "/" + name;
+  const std::string output = dir + "/out-" + name;
+  {
+    std::ofstream file(input);
+    for (const Line &line : lines) {
+      file << line.text << "\n";
+    }
+  }
+  TakeMockSegments();
+  CHECK(TranslateSubtitles(input, output, chain));
+
+  const std::vector<std::string> result = ReadLines(output);
+  CHECK_EQ(result.size(), lines.size());
+  for (size_t i = 0; i < lines.size() && i < result.size(); i++) {
+    if (lines[i].translated ? result[i] == lines[i].text || result[i].empty()
+                            : result[i] != lines[i].text) {
+      ReportFailure(__FILE__, __LINE__,
+                    name + " line " + std::to_string(i + 1) + ": got [" +
+                        result[i] + "] for [" + lines[i].text + "]");
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+TEST(subtitles_srt_keeps_structure) {
+  const std::vector<std::string> result = CheckTranslated(
+      "movie.srt", {{"1", false},
+                    {"00:00:01,000 --> 00:00:02,500", false},
+                    {"Hello there,", true},
+                    {"how are you today?", true},
+                    {"", false},
+                    {"2", false},
+                    {"00:00:03,000 --> 00:00:04,000", false},
+                    {"<i>I am fine.</i>", true},
+                    {"", false},
+                    {"3", false},
+                    {"00:00:04,200 --> 00:00:05,000", false},
+                    {"We went to the", true},
+                    {"", false},
+                    {"4", false},
+                    {"00:00:05,100 --> 00:00:07,000", false},
+                    {"market yesterday.", true},
+                    {"", false},
+                    {"5", false},
+                    {"00:00:10,000 --> 00:00:12,000", false},
+                    {"- Who is it?", true},
+                    {"- Nobody.", true}});
+  // The sentence spread over cues 3 and 4 reaches the model once, whole;
+  // every other cue and dialogue line is a sentence of its own
+  std::vector<std::string> sent = TakeMockSegments();
+  std::sort(sent.begin(), sent.end());
+  const std::vector<std::string> expected = {
+      "Hello there, how are you today?", "I am fine.", "Nobody.",
+      "We went to the market yesterday.", "Who is it?"};
+  CHECK(sent == expected);
+
+  if (result.size() == 21) {
+    TranslationChain chain;
+    CHECK(LoadMockChain(chain, {"de", "en"}));
+    // A cue that is a sentence of its own keeps its tags around the model's
+    // translation, and dialogue lines keep their dashes
+    CHECK_EQ(result[7], "<i>" + chain.Translate("I am fine.") + "</i>");
+    CHECK_EQ(result[19], "- " + chain.Translate("Who is it?"));
+    CHECK_EQ(result[20], "- " + chain.Translate("Nobody."));
+  }
+}
+
+TEST(subtitles_vtt_keeps_header_and_settings) {
+  CheckTranslated("talk.vtt",
+                  {{"WEBVTT", false},
+                   {"", false},
+                   {"NOTE written by hand", false},
+                   {"", false},
+                   {"intro", false},
+                   {"00:01.000 --> 00:02.000 align:start size:50%", false},
+                   {"Good morning", true},
+                   {"everyone.", true},
+                   {"", false},
+                   {"00:02.100 --> 00:03.000 line:0", false},
+                   {"See you soon.", true}});
+}
+
+TEST(subtitles_rejects_missing_file) {
+  TranslationChain chain;
+  CHECK(LoadMockChain(chain, {"de", "en"}));
+  const std::string dir = MakeTempDir();
+  CHECK(!TranslateSubtitles(dir + "/missing.srt", dir + "/out.srt", chain));
+}
@@ -0,0 +1,69 @@
+#include "test.h"
+#include "translation_memory.h"
+#include <fstream>
+
+TEST(memory_reads_tmx) {
+  const std::string path = MakeTempDir() + "/memory.tmx";
+  std::ofstream(path)
+      << "<?xml version=\"1.0\"?>\n<tmx version=\"1.4\"><body>\n"
+         "<tu><tuv xml:lang=\"de-DE\"><seg>Guten  Tag</seg></tuv>\n"
+         "<tuv xml:lang=\"en-US\"><seg>Good day</seg></tuv></tu>\n"
+         // Inline codes go, other tags are unwrapped, entities decoded
+         "<tu><tuv lang=\"EN\"><seg>Press <bpt i=\"1\">&lt;b&gt;</bpt>OK"
+         "<ept i=\"1\">&lt;/b&gt;</ept> &amp; go<ph/></seg></tuv>\n"
+         "<tuv lang=\"DE\"><seg><g id=\"1\">OK</g> dr&#252;cken &amp; "
+         "los&#x21;</seg></tuv></tu>\n"
+         // Units without both languages are skipped
+         "<tu><tuv xml:lang=\"de\"><seg>Nur Deutsch</seg></tuv>\n"
+         "<tuv xml:lang=\"fr\"><seg>Seulement</seg></tuv></tu>\n"
+         "</body></tmx>\n";
+
+  SegmentPairs pairs;
+  CHECK(ReadTmx(path, "de", "en", pairs));
+  CHECK_EQ(pairs.size(), 2u);
+  CHECK_EQ(pairs[0].first, "Guten Tag");
+  CHECK_EQ(pairs[0].second, "Good day");
+  CHECK_EQ(pairs[1].first, "OK dr\xC3\xBC" "cken & los!");
+  CHECK_EQ(pairs[1].second, "Press OK & go");
+}
+
+TEST(memory_reads_tsv) {
+  const std::string path = MakeTempDir() + "/memory.tsv";
+  std::ofstream(path) << "Hallo Welt\tHello world\r\n"
+                         "no tab here\n"
+                         "\tno source\n"
+                         " Danke \t Thanks \tnote\n";
+  SegmentPairs pairs;
+  CHECK(ReadTsv(path, pairs));
+  CHECK_EQ(pairs.size(), 2u);
+  CHECK_EQ(pairs[0].first, "Hallo Welt");
+  CHECK_EQ(pairs[0].second, "Hello world");
+  CHECK_EQ(pairs[1].first, "Danke");
+  CHECK_EQ(pairs[1].second, "Thanks");
+  CHECK(!ReadTsv(path + ".missing", pairs));
+}
+
+TEST(memory_import_merges_and_replaces) {
+  const std::string path = MakeTempDir() + "/memory/de_en.tm";
+  size_t total = 0;
+  CHECK(TranslationMemory::Import(path, {{"Ja", "Yes"}, {"Nein", "No"}},
+                                  total));
+  CHECK_EQ(total, 2u);
+  // A second import adds new segments and replaces known ones
+  CHECK(TranslationMemory::Import(path, {{"  Nein ", "Nope"}, {"Gut", "Good"}},
+                                  total));
+  CHECK_EQ(total, 3u);
+
+  TranslationMemory memory;
+  CHECK(memory.Open(path));
+  std::string translation;
+  CHECK(memory.Lookup("Ja", translation));
+  CHECK_EQ(translation, "Yes");
+  CHECK(memory.Lookup("Nein", translation));
+  CHECK_EQ(translation, "Nope");
+  // Lookups match on the normal form, but are case-sensitive
+  CHECK(memory.Lookup(" Gut\t", translation));
+  CHECK_EQ(translation, "Good");
+  CHECK(!memory.Lookup("gut", translation));
+  CHECK(!TranslationMemory().Open(path + ".missing"));
+}
@@ -0,0 +1,151 @@
+#include "test.h"
+#include "utf8_scan.h"
+#include <random>
+
+namespace {
+
+// Byte-at-a-time decoder following Table 3-7 of the Unicode standard
+size_t ReferenceSplit(std::string_view text, std::vector<uint32_t> &chars) {
+  size_t invalid = std::string::npos;
+  size_t i = 0;
+  while (i < text.size()) {
+    const unsigned char b0 = text[i];
+    auto byte = [&](size_t k) -> int {
+      return i + k < text.size() ? static_cast<unsigned char>(text[i + k])
+                                 : -1;
+    };
+    auto in = [](int b, int low, int high) { return b >= low && b <= high; };
+    size_t length = 0;
+    if (b0 < 0x80) {
+      length = 1;
+    } else if (in(b0, 0xC2, 0xDF)) {
+      length = in(byte(1), 0x80, 0xBF) ? 2 : 0;
+    } else if (in(b0, 0xE0, 0xEF)) {
+      const int low = b0 == 0xE0 ? 0xA0 : 0x80;
+      const int high = b0 == 0xED ? 0x9F : 0xBF;
+      length = in(byte(1), low, high) && in(byte(2), 0x80, 0xBF) ? 3 : 0;
+    } else if (in(b0, 0xF0, 0xF4)) {
+      const int low = b0 == 0xF0 ? 0x90 : 0x80;
+      const int high = b0 == 0xF4 ? 0x8F : 0xBF;
+      length = in(byte(1), low, high) && in(byte(2), 0x80, 0xBF) &&
+                       in(byte(3), 0x80, 0xBF)
+                   ? 4
+                   : 0;
+    }
+    chars.push_back(static_cast<uint32_t>(i));
+    if (length == 0) {
+      if (invalid == std::string::npos) {
+        invalid = i;
+      }
+      length = 1;
+    }
+    i += length;
+  }
+  return invalid;
+}
+
+std::vector<uint32_t> Split(std::string_view text, size_t &invalid) {
+  std::vector<uint32_t> chars;
+  invalid = SplitUtf8(text, chars);
+  return chars;
+}
+
+std::string Join(const std::vector<uint32_t> &values) {
+  std::string out;
+  for (uint32_t value : values) {
+    out += (out.empty() ? "" : ",") + std::to_string(value);
+  }
+  return out;
+}
+
+} // namespace
+
+TEST(utf8_empty_and_ascii) {
+  size_t invalid = 0;
+  CHECK(Split("", invalid).empty());
+  CHECK_EQ(invalid, std::string::npos);
+
+  // Longer than one 16-byte block, so both the vector and tail paths run
+  const std::string ascii = "The quick brown fox jumps over the lazy dog";
+  const auto chars = Split(ascii, invalid);
+  CHECK_EQ(invalid, std::string::npos);
+  CHECK_EQ(chars.size(), ascii.size());
+  for (size_t i = 0; i < chars.size(); i++) {
+    CHECK_EQ(chars[i], i);
+  }
+}
+
+TEST(utf8_multibyte) {
+  size_t invalid = 0;
+  // a, e-acute (2 bytes), euro sign (3), grinning face (4), z
+  CHECK_EQ(Join(Split("a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80z", invalid)),
+           "0,1,3,6,10");
+  CHECK_EQ(invalid, std::string::npos);
+}
+
+TEST(utf8_appends_to_boundaries) {
+  std::vector<uint32_t> chars = {7};
+  CHECK_EQ(SplitUtf8("ab", chars), std::string::npos);
+  CHECK_EQ(Join(chars), "7,0,1");
+}
+
+TEST(utf8_invalid_sequences) {
+  struct Case {
+    const char *name;
+    std::string text;
+    const char *chars;
+    size_t invalid;
+  };
+  const Case cases[] = {
+      {"lone continuation", "a\x80z", "0,1,2", 1},
+      {"overlong 2-byte", "\xC0\x80", "0,1", 0},
+      {"overlong 2-byte C1", "\xC1\xBF", "0,1", 0},
+      {"overlong 3-byte", "\xE0\x80\x80", "0,1,2", 0},
+      {"overlong 4-byte", "\xF0\x80\x80\x80", "0,1,2,3", 0},
+      {"surrogate", "x\xED\xA0\x80", "0,1,2,3", 1},
+      {"past U+10FFFF", "\xF4\x90\x80\x80", "0,1,2,3", 0},
+      {"F5 lead", "\xF5\x80", "0,1", 0},
+      {"FF byte", "ok\xFF", "0,1,2", 2},
+      {"truncated at end", "\xE2\x82", "0,1", 0},
+      {"truncated before ASCII", "\xF0\x9F\x98z", "0,1,2,3", 0},
+      {"largest valid", "\xF4\x8F\xBF\xBF", "0", std::string::npos},
+      {"last before surrogates", "\xED\x9F\xBF", "0", std::string::npos},
+  };
+  for (const auto &c : cases) {
+    size_t invalid = 0;
+    const std::string chars = Join(Split(c.text, invalid));
+    if (chars != c.chars || invalid != c.invalid) {
+      ReportFailure(__FILE__, __LINE__,
+                    std::string(c.name) + ": got " + chars + " invalid at " +
+                        std::to_string(invalid));
+    }
+  }
+}
+
+TEST(utf8_matches_reference_on_random_text) {
+  // Mostly ASCII with valid and broken multi-byte sequences mixed in, at
+  // every alignment relative to the 16-byte blocks
+  const char *const pieces[] = {"a",        "Z",        " ",    "\xC3\xA9",
+                                "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\x80",
+                                "\xC0\xAF", "\xED\xA0\x80", "\xE2\x82",
+                                "\xF4\x90\x80\x80", "\xFF"};
+  std::mt19937 rng(12345);
+  for (int round = 0; round < 2000; round++) {
+    std::string text;
+    const int count = static_cast<int>(rng() % 60);
+    for (int i = 0; i < count; i++) {
+      const size_t pick = rng() % 24;
+      text += pieces[pick < 12 ? pick : pick % 3];
+    }
+    std::vector<uint32_t> expected;
+    const size_t expected_invalid = ReferenceSplit(text, expected);
+    size_t invalid = 0;
+    const auto chars = Split(text, invalid);
+    if (chars != expected || invalid != expected_invalid) {
+      ReportFailure(__FILE__, __LINE__,
+                    "round " + std::to_string(round) + ": got " +
+                        Join(chars) + ", expected " + Join(expected));
+      break;
+    }
+  }
+}
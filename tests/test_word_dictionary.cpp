@@ -0,0 +1,67 @@
+#include "test.h"
+#include "word_dictionary.h"
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+std::string Find(const WordDictionary &dictionary, const std::string &word) {
+  std::string translation;
+  return dictionary.Lookup(word, translation) ? translation : "<none>";
+}
+
+} // namespace
+
+TEST(dictionary_lookup_restores_case) {
+  const std::string path = MakeTempDir() + "/dictionary.bin";
+  CHECK(WordDictionary::Write(path, {{"haus", "house"},
+                                     {"Berlin", "Berlin"},
+                                     {"ampel", "traffic light"},
+                                     {"ABC", "alphabet"}}));
+  WordDictionary dictionary;
+  CHECK(dictionary.Open(path));
+  CHECK_EQ(dictionary.Size(), 4u);
+
+  CHECK_EQ(Find(dictionary, "haus"), "house");
+  CHECK_EQ(Find(dictionary, "Haus"), "House");
+  CHECK_EQ(Find(dictionary, "HAUS"), "HOUSE");
+  CHECK_EQ(Find(dictionary, "Ampel"), "Traffic light");
+  // Exact entries win and keep their own case
+  CHECK_EQ(Find(dictionary, "Berlin"), "Berlin");
+  CHECK_EQ(Find(dictionary, "ABC"), "alphabet");
+  CHECK_EQ(Find(dictionary, "berlin"), "<none>");
+  CHECK_EQ(Find(dictionary, "Hau"), "<none>");
+  CHECK_EQ(Find(dictionary, ""), "<none>");
+}
+
+TEST(dictionary_write_sorts_and_keeps_first_duplicate) {
+  const std::string path = MakeTempDir() + "/dictionary.bin";
+  CHECK(WordDictionary::Write(
+      path, {{"zug", "train"}, {"auto", "car"}, {"zug", "pull"}, {"", "x"}}));
+  WordDictionary dictionary;
+  CHECK(dictionary.Open(path));
+  const auto entries = dictionary.Entries();
+  CHECK_EQ(entries.size(), 3u);
+  CHECK_EQ(entries[0].first, "");
+  CHECK_EQ(entries[1].first, "auto");
+  CHECK_EQ(entries[2].first, "zug");
+  CHECK_EQ(entries[2].second, "train");
+  std::string value;
+  CHECK(dictionary.LookupExact("", value));
+  CHECK_EQ(value, "x");
+}
+
+TEST(dictionary_rejects_bad_files) {
+  const std::string dir = MakeTempDir();
+  WordDictionary dictionary;
+  CHECK(!dictionary.Open(dir + "/missing.bin"));
+
+  std::ofstream(dir + "/magic.bin") << "NOTADICT" << std::string(8, '\0');
+  CHECK(!dictionary.Open(dir + "/magic.bin"));
+
+  // Valid header promising more index entries than the file holds
+  CHECK(WordDictionary::Write(dir + "/cut.bin", {{"a", "b"}, {"c", "d"}}));
+  std::filesystem::resize_file(dir + "/cut.bin", 30);
+  CHECK(!dictionary.Open(dir + "/cut.bin"));
+  CHECK_EQ(Find(dictionary, "a"), "<none>");
+}